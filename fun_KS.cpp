@@ -23,6 +23,12 @@
 // do not initialize and check LSD pointers
 //#define NO_POINTER_INIT
 
+// cross-check firm capital stock running totals against full vintage scans
+//#define CHECK_VINT_TOT
+
+// use the iterative (reference) rationing of consumption-good demand
+//#define D2_ITERATIVE
+
 
 /*======================== ADDITIONAL CODE TO INCLUDE ========================*/
 
@@ -178,8 +184,16 @@ MODELEND
 
 void close_sim( void )
 {
-	object *cur;
+	object *cur, *cur1;
 
 	CYCLES( root, cur, "Country" )				// scan all country objects
+	{
+		if ( P_EXTS( cur, countryE ) == NULL )	// country not initialized?
+			continue;
+
+		CYCLES( V_EXTS( cur, countryE, conSec ), cur1, "Firm2" )
+			DELETE_EXTS( cur1, firm2E );		// reclaim firm extensions
+
 		DELETE_EXTS( cur, countryE );			// reclaim allocated memory
+	}
 }
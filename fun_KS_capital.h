@@ -94,8 +94,9 @@ CYCLE( cur, "Firm1" )
 }
 
 // quit candidate firms exit, except the best one if all going to quit
+objVecT exits;									// firms to exit in batch
 v[6] = i = j = 0;								// firm counters
-CYCLE_SAFE( cur, "Firm1" )
+CYCLE( cur, "Firm1" )
 {
 	if ( quit[ i ] )
 	{
@@ -105,7 +106,7 @@ CYCLE_SAFE( cur, "Firm1" )
 			if ( VS( cur, "_NW1" ) < 0 )		// count bankruptcies
 				++v[6];
 
-			exit_firm( var, cur );				// del obj & collect liq. value
+			exits.push_back( cur );				// mark to exit in batch
 		}
 		else
 			if ( h == 0 && i == k )				// best firm must get new equity
@@ -122,15 +123,18 @@ CYCLE_SAFE( cur, "Firm1" )
 	++i;
 }
 
+exit_firms( var, THIS, exits );					// remove all exiting firms
+
 V( "f1rescale" );								// redistribute exiting m.s.
 
 // replace exiting firms by entrants
-entry_firm1( var, THIS, j, false );				// add entrant-firm objects
+entry_firm1( THIS, j, false );					// add entrant-firm objects
 
 INCR( "cEntry1", v[1] );						// add cost of additional equity
 WRITES( SECSTAL1, "exit1fail", v[6] / F1 );
 
 V( "f1rescale" );								// redistribute entrant m.s.
+firm1_stale( PARENT );							// firm set changed
 INIT_TSEARCHT( "Firm1", i );					// prepare turbo search indexing
 
 RESULT( ( double ) j / F1 )
@@ -143,14 +147,14 @@ EQUATION( "A1" )
 Labor productivity of capital-good sector
 */
 V( "PPI" );										// ensure m.s. are updated
-RESULT( WHTAVE( "_Btau", "_f1" ) )
+RESULT( wavg( THIS, "_Btau", "_f1" ) )
 
 EQUATION( "E1" )
 /*
 Emission coefficient of capital-good sector (weighted average)
 */
 V( "PPI" );										// ensure m.s. are updated
-RESULT( WHTAVE( "_EAtau", "_f1" ) )
+RESULT( wavg( THIS, "_EAtau", "_f1" ) )
 
 EQUATION( "D1" )
 /*
@@ -230,7 +234,7 @@ EQUATION( "PPI" )
 Producer price index
 */
 V( "f1rescale" );								// ensure m.s. computed/rescaled
-RESULT( WHTAVE( "_p1", "_f1" ) )
+RESULT( wavg( THIS, "_p1", "_f1" ) )
 
 
 EQUATION( "Q1" )
@@ -24,9 +24,122 @@ struct firmRank									// element of pecking order rank
 typedef pair < int, object * > firmPairT;		// firm-to-object pair template
 typedef map < int, object * > firmMapT;			// firm-to-object map template
 typedef set < object * > firmSeT;				// firm-set template
+typedef set < object * > objSeT;				// set of objects template
 typedef list < firmRank > firmLisT;				// ranked-firms list template
 typedef vector < double > dblVecT;				// vector of doubles template
 typedef vector < object * > objVecT;			// vector of objects template
+typedef unsigned long long vintKeyT;			// vintage (period, supplier) key
+typedef map < vintKeyT, objSeT > vintRegT;		// key-to-vintages map template
+typedef map < int, double > vintAgeT;			// period-to-machines map template
+
+
+/*========================= VINTAGE TABLE CLASS ==============================*/
+
+struct vintTabT									// firm vintage table
+{
+	// columns (one row per vintage, from the oldest to the newest), kept
+	// current by the vintage functions, which write changes back to LSD
+	dblVecT n, A, p, tV, EA;					// '__nVint', '__Avint', ...
+	dblVecT toUse, L;							// '__toUseVint', '__Lvint'
+	dblVecT Ld;									// cumulative '__LdVint' in firm
+	vector < char > chain;						// previous row is SHOOK
+	objVecT vint;								// pointers to vintage objects
+};
+
+
+struct vintActT									// planned vintage change
+{
+	int i;										// vintage table row
+	double n;									// new size (0: remove)
+};
+
+typedef vector < vintActT > vintActVecT;		// vintage changes template
+
+
+
+struct edgeT									// supplier-client relation
+{
+	object *sup = NULL, *cli = NULL;			// supplier and client firms
+	int IDs = 0, IDc = 0;						// supplier and client IDs
+	int tSel = 0, tOrd = -1;					// last selection/order periods
+	double nOrd = 0, nCan = 0;					// machines ordered/canceled
+	int prevS = -1, nextS = -1;					// supplier adjacency links
+	int prevC = -1, nextC = -1;					// client adjacency links
+	int prevB = -1, nextB = -1;					// expiry bucket links
+};
+
+#define EXPBKT		4							// edge expiry buckets (ring)
+
+struct orderBookT								// supplier period order book
+{
+	int t = -1;									// period of orders
+	vector < int > ord;							// edges with orders in period
+	double nOrd = 0, nCan = 0;					// machines ordered/canceled
+};
+
+struct edgeStoreT								// supplier-client graph
+{
+	vector < edgeT > e;							// edges (free if no supplier)
+	vector < int > freeE;						// free edge slots
+	vector < int > headS, tailS, degS;			// supplier lists (by ID1)
+	vector < int > headC, tailC, degC;			// client lists (by ID2)
+	vector < orderBookT > book;					// order books (by ID1)
+	vector < int > headB = vector < int > ( EXPBKT, -1 );// buckets by tSel
+	vector < int > tB = vector < int > ( EXPBKT, -1 );// bucket selection time
+	int tExp = -1;								// period of last expiry
+};
+
+struct offerTabT								// per-period supplier offers
+{
+	int t = -1;									// period table was built
+	dblVecT p1, cTau, cost;						// price, op. cost, payback cost
+};
+
+struct firmRegT									// dense ID-indexed firm registry
+{
+	objVecT slot;								// firm pointers by ID
+	vector < bool > live;						// live firm IDs bitmap
+	int n = 0;									// number of live firms
+	vector < int > ids;							// dense list of live IDs
+	vector < int > pos;							// ID position in live list
+	vector < bool > mark;						// sampling scratch bitset
+};
+
+struct firm2SnapT								// per-period firm 2 snapshot
+{
+	int t = -1;									// period snapshot was built
+	objVecT firm;								// pointers to firms
+	dblVecT f2, p2, sup2;						// share, price, available supply
+	dblVecT d2, l2;								// fulfilled/unsatisfied demand
+};
+
+struct expect2ParT								// demand expectation parameters
+{
+	double e[ 9 ];								// e0...e8
+	double dGDP;								// past GDP growth
+};
+
+// demand expectation kernel for a rule (n firms, lag-major past demands)
+typedef void ( *expect2KernT )( int n, const double *D, const double *Dd,
+								const double *cur, const expect2ParT &par,
+								double *out );
+
+#define SUM2PH		4							// fused reduction phases
+
+struct sum2PhT									// fused firm 2 reduction phase
+{
+	int t = -1;									// period sums were computed
+	dblVecT sum;								// phase variable sums
+};
+
+#define WAVGBDL		6							// weighted-average bundles
+
+struct wavgBdlT									// weighted-average bundle
+{
+	int t = -1;									// period sums were computed
+	dblVecT vw;									// sum of value * weight
+	double w = 0;								// sum of weights (first pair)
+};
 
 
 /*======================== COUNTRY EXTENSION CLASS ===========================*/
@@ -37,8 +150,63 @@ struct countryE
 	object *finSec, *capSec, *conSec, *labSup, *macSta, *secSta, *labSta;
 
 	// country speed-up vectors & maps
-	objVecT firm2ptr;							// pointers to firms in sector 2
-	firmMapT firm2map;							// ID to pointer map for sector 2
+	firmRegT firm2reg;							// ID-indexed sector 2 firms
+	edgeStoreT edges;							// supplier-client graph
+	offerTabT offer1;							// sector 1 offers by ID
+	vintRegT vint2reg;							// live vintages by key
+	vintAgeT vint2age;							// machines by build period
+	firm2SnapT firm2snap;						// firm 2 market snapshot
+	sum2PhT sum2ph[ SUM2PH ];					// firm 2 fused reductions
+	wavgBdlT wavg[ WAVGBDL ];					// weighted-average bundles
+	expect2KernT exp2kern = NULL;				// demand expectation kernel
+	int exp2lags = 1;							// lags used by kernel
+};
+
+
+/*========================= FIRM EXTENSION CLASSES ===========================*/
+
+struct vintTotT									// firm capital stock totals
+{
+	double n = 0, nA = 0, nP = 0;				// sum of n, n*A, n*p
+	double nIA = 0, nAEA = 0;					// sum of n/A, n*A*EA
+};
+
+struct vintSumT									// firm vintage summary
+{
+	int t = -1, tRS = -1, tOut = -1;			// periods parts were computed
+
+	// capital stock part
+	double n = 0, nA = 0, nIA = 0;				// sum of n, n*A, n/A
+	double nP = 0, EA = 0;						// sum of n*p, avg. emiss. int.
+	object *old = NULL;							// oldest vintage
+
+	// scrapping part ('__RSvint')
+	double RSpre = 0, RSall = 0;				// to first 0 and all vintages
+
+	// output part ('_alloc2')
+	double Q = 0, E = 0;						// output and emissions
+};
+
+struct scrapPlanT								// firm vintage scrapping plan
+{
+	int t = -1;									// period plan was computed
+	int tCut = -1;								// period cutoff was computed
+	double tMin = 0;							// oldest period in tech. life
+	double Acut = 0;							// productivity to replace below
+	bool strict = false;						// cutoff itself not replaced
+};
+
+struct firm2E
+{
+	vintTabT tab;								// vintage table
+	vintTotT tot;								// running capital stock totals
+	vintSumT sum;								// fused vintage summary
+	scrapPlanT scrap;							// vintage scrapping plan
+
+	double Inom = 0;							// capital deployed in period
+	int tInom = -1;								// period capital was deployed
+
+	int supEdge = -1;							// current supplier edge
 };
 
 
@@ -51,11 +219,10 @@ struct countryE
 /*========================= HOOK-RELATED DEFINITIONS =========================*/
 
 // number of dynamic hooks per object type
-#define FIRM2HK		2					// Firm2
+#define FIRM2HK		1					// Firm2
 
 // dynamic hook name to number
-#define SUPPL		0					// from Firm2 to Broch (in Firm2)
-#define TOPVINT		1					// from Firm2 to Vint (in Firm2)
+#define TOPVINT		0					// from Firm2 to Vint (in Firm2)
 
 
 /*======================= OBJECT-LOCATION DEFINITIONS ========================*/
@@ -84,6 +251,15 @@ struct countryE
 #define LABSTAL0 V_EXT( countryE, labSta )
 #define LABSTAL1 V_EXTS( PARENT, countryE, labSta )
 #define LABSTAL2 V_EXTS( GRANDPARENT, countryE, labSta )
+#define EDGESL0 ( & V_EXT( countryE, edges ) )
+#define EDGESL1 ( & V_EXTS( PARENT, countryE, edges ) )
+#define EDGESL2 ( & V_EXTS( GRANDPARENT, countryE, edges ) )
+
+// cycle over the edges (index E) of supplier/client firm ID in graph G
+#define CYCLE_EDGES_S( G, ID, E ) \
+	for ( E = edge_first( ( G )->headS, ID ); E >= 0; E = ( G )->e[ E ].nextS )
+#define CYCLE_EDGES_C( G, ID, E ) \
+	for ( E = edge_first( ( G )->headC, ID ); E >= 0; E = ( G )->e[ E ].nextC )
 
 
 /*============================== SUPPORT MACROS ==============================*/
@@ -100,12 +276,19 @@ struct countryE
 #define ROUND( V, Ref, Tol ) ( abs( V - Ref ) > Tol ? V : Ref )
 
 // macros to pack/unpack vintage (machine technological generation) data
+// keys are exact in LSD (double) variables up to period 2^21
 #define VNT( T0, IDsuppl ) \
-	( 10000 * ( int ) trunc( T0 ) + ( int ) trunc( IDsuppl ) )
+	( ( ( vintKeyT ) ( T0 ) << 32 ) | ( vintKeyT ) ( IDsuppl ) )
 #define T0( IDvint ) \
-	( ( int ) round( trunc( IDvint ) / 10000 ) )
+	( ( int ) ( ( vintKeyT ) ( IDvint ) >> 32 ) )
 #define SUP( IDvint ) \
-	( ( int ) ( trunc( IDvint ) - 10000 * T0( IDvint ) ) )
+	( ( int ) ( ( vintKeyT ) ( IDvint ) & 0xFFFFFFFF ) )
+
+// number of independent accumulators (lanes) in vectorizable kernels
+#define VLANES		4
+
+// relative tolerance when checking capital stock running totals
+#define TOL_VINT_TOT 1e-6
 
 // macros to work with standard C arrays
 #define LEN_ARR( A ) ( ( int ) ( sizeof A / sizeof A[0] ) )
@@ -19,77 +19,100 @@
 EQUATION( "D2" )
 /*
 Demand fulfilled by firms in consumption-good sector
-Update '_D2', '_l2'
+Update '_D2', '_l2', 'D2iter', 'D2out'
 */
 
-k = V( "F2" );									// number of firms
 v[1] = VS( PARENT, "Cd" );						// nominal demand
 
-// create and fill temporary share and supply vectors & initialize firm demand
-dblVecT f2( k ), p2( k ), sup2( k );
+// firm share, price, supply and fulfilled demand vectors
+firm2SnapT *snap = firm2_snapshot( PARENT );
+k = snap->firm.size( );							// number of firms
+dblVecT &f2 = snap->f2, &p2 = snap->p2, &sup2 = snap->sup2,
+		&d2 = snap->d2, &l2 = snap->l2;
 
-j = 0;
-CYCLE( cur, "Firm2" )
+#ifndef D2_ITERATIVE
+
+// exact (water-filling) allocation: each firm supplies the minimum between
+// its available supply and its share of the demand level lambda, set to
+// exhaust nominal demand, so firms run out of supply in the order of the
+// level cap/f2 ($ supply over share)
+vector < pair < double, int > > lev;			// firm saturation levels
+
+v[3] = 0;										// shares yet unsaturated
+for ( j = 0; j < k; ++j )
+	if ( f2[ j ] > 0 && sup2[ j ] > 0 )			// firm has demand to supply
+	{
+		lev.push_back( make_pair( sup2[ j ] * p2[ j ] / f2[ j ], j ) );
+		v[3] += f2[ j ];
+	}
+
+sort( lev.begin( ), lev.end( ) );
+
+i = 0;											// firms out of supply
+v[2] = v[1];									// remaining unallocated $ demand
+for ( auto itr = lev.begin( ); itr != lev.end( ); ++itr, ++i )
 {
-	sup2[ j ] = VS( cur, "_Q2e" ) + VLS( cur, "_N", 1 );// firm available supply
-	f2[ j ] = VS( cur, "_f2" );					// firm market share
-	p2[ j ] = VS( cur, "_p2" );					// firm price
-	WRITES( cur, "_D2", 0 );					// demand fulfilled accumulator
-	WRITES( cur, "_l2", 0 );					// assume no unsatisfied demand
-	++j;
+	if ( itr->first * v[3] > v[2] )				// demand exhausted before?
+		break;
+
+	j = itr->second;							// sell all available supply
+	v[2] -= sup2[ j ] * p2[ j ];
+	v[3] -= f2[ j ];
 }
 
+// demand level (lambda), no limit if all firms sell all supply
+v[4] = i < ( int ) lev.size( ) ? v[2] / v[3] : DBL_MAX;
+
+kern_ration_fill( k, v[1], v[4], f2.data( ), p2.data( ), sup2.data( ),
+				  d2.data( ), l2.data( ) );
+
+WRITE( "D2iter", 0 );							// no rationing round
+
+#else
+
+// working copies of shares and supply, changed along the rationing rounds
+dblVecT f2w( f2 ), sup2w( sup2 );
+d2.assign( k, 0 );
+l2.assign( k, 0 );
+
 // cycle through firms until all demand is allocated or no more product to sell
-v[0] = i = 0;									// fulfilled demand accumulator
+i = 0;											// rationing rounds
 while ( v[1] > 0.01 )
 {
-	v[2] = v[1];								// remaining unallocated $ demand
-	v[3] = j = 0;								// shares yet unallocated
-	CYCLE( cur, "Firm2" )
-	{
-		if ( f2[ j ] > 0 )						// firm has demand to supply
-		{
-			if ( sup2[ j ] > 0 )				// product to supply?
-			{
-				v[4] = v[1] * f2[ j ];			// firm $ demand allocation
-				v[5] = v[4] / p2[ j ];			// firm # demand allocation
-
-				if ( v[5] <= sup2[ j ] )		// can supply all demanded?
-				{
-					INCRS( cur, "_D2", v[5] );	// supply all demanded
-					v[0] += v[5];				// accumulate to total # demand
-					v[2] -= v[4];				// discount from desired $ demand
-					v[3] += f2[ j ];			// save share yet to allocate
-					sup2[ j ] -= v[5];			// make supplied # unavailable
-				}
-				else
-				{
-					if ( i == 0 )				// unsatisfied demand metric
-						WRITES( cur, "_l2", v[5] - sup2[ j ] );
-
-					INCRS( cur, "_D2", sup2[ j ] );// supply all # available
-					v[0] += sup2[ j ];			// accumulate to total # demand
-					v[2] -= sup2[ j ] * p2[ j ];// discount from desired $ demand
-					f2[ j ] = sup2[ j ] = 0;	// nothing else to supply
-				}
-			}
-			else
-				f2[ j ] = 0;					// nothing else to supply
-		}
-
-		++j;
-	}
+	// remaining unallocated $ demand and shares yet unallocated
+	v[2] = v[1] - kern_ration_round( k, v[1], f2w.data( ), p2.data( ),
+									 sup2w.data( ), d2.data( ), l2.data( ),
+									 i == 0, & v[3] );
+	++i;
 
 	if ( v[3] > 0 )								// unallocated shares remaining?
 		for ( j = 0; j < k; ++j )
-			f2[ j ] /= v[3];					// rescale remaining firms
+			f2w[ j ] /= v[3];					// rescale remaining firms
 	else
 		break;									// nothing else to supply
 
 	v[1] = v[2];								// update unallocated
-	++i;
 }
 
+WRITE( "D2iter", i );
+
+#endif
+
+// write back fulfilled and unsatisfied demand once per firm
+v[0] = 0;										// fulfilled demand accumulator
+h = 0;											// firms out of supply
+for ( j = 0; j < k; ++j )
+{
+	WRITES( snap->firm[ j ], "_D2", d2[ j ] );
+	WRITES( snap->firm[ j ], "_l2", l2[ j ] );
+	v[0] += d2[ j ];							// accumulate to total # demand
+
+	if ( sup2[ j ] > 0 && d2[ j ] >= sup2[ j ] )// all supply sold?
+		++h;
+}
+
+WRITE( "D2out", h );
+
 RESULT( v[0] )
 
 
@@ -145,8 +168,9 @@ CYCLE( cur, "Firm2" )
 }
 
 // quit candidate firms exit, except the best one if all going to quit
+objVecT exits;									// firms to exit in batch
 v[6] = i = j = 0;								// firm counters
-CYCLE_SAFE( cur, "Firm2" )
+CYCLE( cur, "Firm2" )
 {
 	if ( quit[ i ] )
 	{
@@ -156,7 +180,7 @@ CYCLE_SAFE( cur, "Firm2" )
 			if ( VS( cur, "_NW2" ) < 0 )		// count bankruptcies
 				++v[6];
 
-			exit_firm( var, cur );				// del obj & collect liq. val.
+			exits.push_back( cur );				// mark to exit in batch
 		}
 		else
 			if ( h == 0 && i == k )				// best firm must get new equity
@@ -173,6 +197,8 @@ CYCLE_SAFE( cur, "Firm2" )
 	++i;
 }
 
+exit_firms( var, THIS, exits );					// remove all exiting firms
+
 V( "f2rescale" );								// redistribute exiting m.s.
 
 // replace exiting firms by entrants
@@ -182,7 +208,7 @@ INCR( "cEntry2", v[1] );						// add cost of additional equity
 WRITES( SECSTAL1, "exit2fail", v[6] / F2 );
 
 V( "f2rescale" );								// redistribute entrant m.s.
-V( "firm2maps" );								// update firm mapping vectors
+V( "firm2maps" );								// refresh firm data
 
 RESULT( ( double ) j / F2 )
 
@@ -194,14 +220,14 @@ EQUATION( "A2" )
 Machine-level weighted-average labor productivity of consumption-good sector
 */
 V( "CPI" );										// ensure m.s. are updated
-RESULT( WHTAVE( "_A2", "_f2" ) )
+RESULT( wavg( THIS, "_A2", "_f2" ) )
 
 
 EQUATION( "CI" )
 /*
 Total canceled investment in consumption-good sector
 */
-RESULT( SUM( "_CI" ) )
+RESULT( sum2( THIS, "_CI" ) )
 
 
 EQUATION( "CPI" )
@@ -209,7 +235,7 @@ EQUATION( "CPI" )
 Consumer price index
 */
 V( "f2rescale" );								// ensure m.s. computed/rescaled
-RESULT( WHTAVE( "_p2", "_f2" ) )
+RESULT( wavg( THIS, "_p2", "_f2" ) )
 
 
 EQUATION( "D2d" )
@@ -222,8 +248,85 @@ RESULT( VS( PARENT, "Cd" ) / V( "CPI" ) )
 EQUATION( "D2e" )
 /*
 Demand expectation of firms in consumer-good sector
+Adaptive expectations of all firms are computed by the expectation rule kernel
+selected at initialization, over firm past demand arrays
+Also updates '_D2e'
 */
-RESULT( SUM( "_D2e" ) )
+
+cur1 = PARENT;									// country object
+expect2ParT par;								// expectation parameters
+expect2KernT kern = V_EXTS( cur1, countryE, exp2kern );
+h = V_EXTS( cur1, countryE, exp2lags );			// req. number of data periods
+
+par.e[ 0 ] = V( "e0" );							// animal spirits parameter
+for ( i = 1; i <= 8; ++i )
+	par.e[ i ] = 0;
+
+switch ( h )									// only parameters in use
+{
+	case 4:
+		par.e[ 1 ] = V( "e1" );					// weights of t-1...t-4 demand
+		par.e[ 2 ] = V( "e2" );
+		par.e[ 3 ] = V( "e3" );
+		par.e[ 4 ] = V( "e4" );
+		break;
+
+	case 2:
+		par.e[ 5 ] = V( "e5" );					// accelerating GD weight
+		par.e[ 6 ] = V( "e6" );					// adaptive weight
+		par.e[ 7 ] = V( "e7" );					// extrapolative weights
+		par.e[ 8 ] = V( "e8" );
+		break;
+}
+
+par.dGDP = h == 2 ? VLS( cur1, "dGDP", 1 ) : 0;	// past GDP growth
+
+// firms with enough data, their past demands (lag-major) and expectations
+objVecT firm;
+dblVecT D, Dd, De, out;
+
+v[0] = 0;										// expectations accumulator
+CYCLE( cur2, "Firm2" )
+{
+	j = VS( cur2, "_t2ent" );					// firm entry period
+
+	if ( j > 0 && j >= T - 1 - h )				// entrant or too few data?
+	{
+		v[1] = VLS( cur2, "_D2e", 1 );			// keep past expectation
+		WRITES( cur2, "_D2e", v[1] );
+		v[0] += v[1];
+	}
+	else
+		firm.push_back( cur2 );
+}
+
+k = firm.size( );
+D.resize( h * k );
+Dd.resize( h * k );
+De.resize( k );
+out.resize( k );
+
+for ( j = 0; j < k; ++j )
+{
+	for ( i = 1; i <= h; ++i )
+	{
+		D[ ( i - 1 ) * k + j ] = VLS( firm[ j ], "_D2", i );
+		Dd[ ( i - 1 ) * k + j ] = VLS( firm[ j ], "_D2d", i );
+	}
+
+	De[ j ] = VLS( firm[ j ], "_D2e", 1 );
+}
+
+if ( k > 0 )
+	kern( k, D.data( ), Dd.data( ), De.data( ), par, out.data( ) );
+
+for ( j = 0; j < k; ++j )
+{
+	WRITES( firm[ j ], "_D2e", out[ j ] );
+	v[0] += out[ j ];
+}
+
+RESULT( v[0] )
 
 
 EQUATION( "Deb2" )
@@ -238,7 +341,7 @@ EQUATION( "Div2" )
 Total dividends paid by firms in consumption-good sector
 */
 V( "Tax2" );									// ensure dividends are computed
-RESULT( SUM( "_Div2" ) )
+RESULT( sum2( THIS, "_Div2" ) )
 
 
 EQUATION( "EI" )
@@ -246,19 +349,164 @@ EQUATION( "EI" )
 Total expansion investment in consumption-good sector
 */
 V( "CI" );										// ensure cancellations acct'd
-RESULT( SUM( "_EI" ) )
+RESULT( sum2( THIS, "_EI" ) )
 
 
 EQUATION( "Eavg" )
 /*
 Weighted average competitiveness of firms in consumption-good sector
-*/
+Competitiveness and market shares of all firms are computed in a single
+sector-level stage, over firm arrays
+If household segments are enabled, also computes the firm demand shares as
+the budget-weighted average of the segment shares, tilted by the relative
+competitiveness each segment perceives
+Also updates '_E', '_f2', '_f2d'
+*/
+
+// sector averages, computed before firm data as in the firm-level equations
+v[1] = V( "emissions_c_avg" );					// average emissions
+v[2] = V( "p2avg" );							// average price
+v[3] = VL( "l2avg", 1 ) + 1;					// past average unfilled demand
+v[4] = VL( "Eavg", 1 );							// entrant competitiveness
+v[5] = V( "omega1" );							// price weight
+v[6] = V( "omega2" );							// unfilled demand weight
+v[7] = V( "omega3" );							// emissions weight
+v[8] = V( "chi" );								// replicator dynamics coeff.
+v[9] = V( "f2min" );							// minimum share to stay
+v[10] = VL( "K", 1 );							// past capital in sector
+
+// firm life cycle, relative price, unfilled demand and emissions terms and
+// share arrays
+objVecT firm;
+dblVecT life, cp, cl, ce, f2l, K, E, f2;
 
-v[0] = 0;
 CYCLE( cur, "Firm2" )
-	if ( VS( cur, "_life2cycle" ) > 0 )			// consider only non-entrants
-		v[0] += VS( cur, "_E" ) * VLS( cur, "_f2", 1 );
-												// compute weighted average
+{
+	firm.push_back( cur );
+	life.push_back( VS( cur, "_life2cycle" ) );
+	f2l.push_back( VLS( cur, "_f2", 1 ) );
+
+	if ( life.back( ) > 0 )						// producing firm?
+	{
+		v[12] = VS( cur, "_emissions_c" );
+		ce.push_back( v[12] > 0 ? v[12] / v[1] : 0 );
+		cp.push_back( VS( cur, "_p2" ) / v[2] );
+		cl.push_back( v[3] > 1 ? ( VLS( cur, "_l2", 1 ) + 1 ) / v[3] : 1 );
+		K.push_back( VS( cur, "_t2ent" ) == T - 2 ?// first-period entrant?
+					 VLS( cur, "_K", 1 ) : -1 );
+	}
+	else										// non-producing entrant
+	{
+		ce.push_back( 0 );
+		cp.push_back( 1 );
+		cl.push_back( 1 );
+		K.push_back( -1 );
+	}
+}
+
+k = firm.size( );
+E.resize( k );
+f2.resize( k );
+
+// competitiveness and past-share weighted average (entrants excluded)
+v[0] = 0;
+for ( j = 0; j < k; ++j )
+{
+	E[ j ] = life[ j ] > 0 ?
+			 - v[5] * cp[ j ] - v[6] * cl[ j ] - v[7] * ce[ j ] : v[4];
+	v[0] += life[ j ] > 0 ? E[ j ] * f2l[ j ] : 0;
+}
+
+// replicator equation, lower-bounded slightly below exit threshold to
+// ensure firm sells production before leaving the market; first-period
+// entrants get the same as capital share, but over minimum
+v[11] = 0;										// add-up market shares
+for ( j = 0; j < k; ++j )
+{
+	if ( life[ j ] == 0 )						// entrant firm state
+		f2[ j ] = 0;
+	else
+		if ( f2l[ j ] == 0 && K[ j ] >= 0 )		// first-period entrant?
+			f2[ j ] = max( K[ j ] / v[10], v[9] );
+		else
+			f2[ j ] = max( f2l[ j ] * ( 1 - v[8] * ( E[ j ] / v[0] - 1 ) ),
+						   0.99 * v[9] );
+
+	v[11] += f2[ j ];
+}
+
+// rescale market shares to ensure adding to 1, ignoring rounding errors
+if ( ROUND( v[11], 1, 0.001 ) != 1.0 )
+{
+	if ( v[11] > 0 )							// production ok?
+		for ( j = 0; j < k; ++j )
+			f2[ j ] /= v[11];
+	else
+		for ( j = 0; j < k; ++j )
+			f2[ j ] = 1.0 / k;					// firm fair share
+}
+
+// demand shares, by default the market shares
+dblVecT f2d( f2 );
+
+if ( VS( PARENT, "flagSegment" ) != 0 && v[0] != 0 )
+{
+	// segment weights and budget shares
+	dblVecT w1, w2, w3, beta, Es( k ), fs( k );
+	CYCLE( cur, "Segment" )
+	{
+		w1.push_back( VS( cur, "omega1s" ) );
+		w2.push_back( VS( cur, "omega2s" ) );
+		w3.push_back( VS( cur, "omega3s" ) );
+		beta.push_back( VS( cur, "betaS" ) );
+	}
+
+	f2d.assign( k, 0 );
+	v[13] = 0;									// budget shares accumulator
+	for ( h = 0; h < ( int ) beta.size( ); ++h )
+	{
+		// segment competitiveness and its weighted average
+		v[14] = 0;
+		for ( j = 0; j < k; ++j )
+		{
+			Es[ j ] = life[ j ] > 0 ? - w1[ h ] * cp[ j ] - w2[ h ] * cl[ j ] -
+									  w3[ h ] * ce[ j ] : v[4];
+			v[14] += life[ j ] > 0 ? Es[ j ] * f2l[ j ] : 0;
+		}
+
+		// market shares tilted by segment relative competitiveness
+		v[15] = 0;
+		for ( j = 0; j < k; ++j )
+		{
+			fs[ j ] = v[14] != 0 ? max( f2[ j ] * ( 1 - v[8] *
+										( Es[ j ] / v[14] - E[ j ] / v[0] ) ),
+									   0 ) : f2[ j ];
+			v[15] += fs[ j ];
+		}
+
+		if ( v[15] > 0 && beta[ h ] > 0 )		// add normalized segment share
+		{
+			for ( j = 0; j < k; ++j )
+				f2d[ j ] += beta[ h ] * fs[ j ] / v[15];
+
+			v[13] += beta[ h ];
+		}
+	}
+
+	if ( v[13] > 0 )							// normalize to budget shares
+		for ( j = 0; j < k; ++j )
+			f2d[ j ] /= v[13];
+	else
+		f2d = f2;
+}
+
+for ( j = 0; j < k; ++j )
+{
+	WRITES( firm[ j ], "_E", E[ j ] );
+	WRITES( firm[ j ], "_f2", f2[ j ] );
+	WRITES( firm[ j ], "_f2d", f2d[ j ] );
+}
+
 RESULT( v[0] )
 
 
@@ -281,7 +529,7 @@ EQUATION( "Inom" )
 /*
 Aggregated investment (nominal/currency terms)
 */
-RESULT( SUM( "_Inom" ) )
+RESULT( sum2( THIS, "_Inom" ) )
 
 
 EQUATION( "Ireal" )
@@ -295,7 +543,7 @@ EQUATION( "JO2" )
 /*
 Open job positions in consumption-good sector
 */
-RESULT( SUM( "_JO2" ) )
+RESULT( sum2( THIS, "_JO2" ) )
 
 
 EQUATION( "K" )
@@ -303,21 +551,21 @@ EQUATION( "K" )
 Total capital accumulated by firms in consumption-good sector
 After new machine orders are delivered
 */
-RESULT( SUM( "_K" ) )
+RESULT( sum2( THIS, "_K" ) )
 
 
 EQUATION( "Kd" )
 /*
 Total desired capital stock of firms in consumption-good sector
 */
-RESULT( SUM( "_Kd" ) )
+RESULT( sum2( THIS, "_Kd" ) )
 
 
 EQUATION( "Knom" )
 /*
 Total capital (nominal/money terms) in consumption-good sector
 */
-RESULT( SUM( "_Knom" ) )
+RESULT( sum2( THIS, "_Knom" ) )
 
 
 EQUATION( "L2" )
@@ -333,14 +581,14 @@ EQUATION( "L2d" )
 /*
 Total labor demand from firms in consumption-good sector
 */
-RESULT( SUM( "_L2d" ) )
+RESULT( sum2( THIS, "_L2d" ) )
 
 
 EQUATION( "N" )
 /*
 Total inventories (real terms)
 */
-RESULT( SUM( "_N" ) )
+RESULT( sum2( THIS, "_N" ) )
 
 
 EQUATION( "NW2" )
@@ -354,35 +602,35 @@ EQUATION( "Pi2" )
 /*
 Total profits of consumer-good sector
 */
-RESULT( SUM( "_Pi2" ) )
+RESULT( sum2( THIS, "_Pi2" ) )
 
 
 EQUATION( "Q2" )
 /*
 Total planned output before labor/financial constraints in consumption-good sector
 */
-RESULT( SUM( "_Q2" ) )
+RESULT( sum2( THIS, "_Q2" ) )
 
 
 EQUATION( "Q2d" )
 /*
 Total desired real output of consumption-good sector
 */
-RESULT( SUM( "_Q2d" ) )
+RESULT( sum2( THIS, "_Q2d" ) )
 
 
 EQUATION( "Q2e" )
 /*
 Total effective output of firms in consumption-good sector
 */
-RESULT( SUM( "_Q2e" ) )
+RESULT( sum2( THIS, "_Q2e" ) )
 
 
 EQUATION( "emissions_c" )
 /*
 Aggregate emissions of firms in consumption-good sector
 */
-RESULT( SUM( "_emissions_c" ) )
+RESULT( sum2( THIS, "_emissions_c" ) )
 
 
 EQUATION( "Q2p" )
@@ -404,7 +652,7 @@ EQUATION( "S2" )
 /*
 Total sales of consumption-good sector
 */
-RESULT( SUM( "_S2" ) )
+RESULT( sum2( THIS, "_S2" ) )
 
 
 EQUATION( "SI" )
@@ -412,21 +660,21 @@ EQUATION( "SI" )
 Total substitution investment in consumption-good sector
 */
 V( "CI" );										// ensure cancellations acct'd
-RESULT( SUM( "_SI" ) )
+RESULT( sum2( THIS, "_SI" ) )
 
 
 EQUATION( "Tax2" )
 /*
 Total taxes paid by firms in consumption-good sector
 */
-RESULT( SUM( "_Tax2" ) )
+RESULT( sum2( THIS, "_Tax2" ) )
 
 
 EQUATION( "W2" )
 /*
 Total wages paid by all firms in sector 2
 */
-RESULT( SUM( "_W2" ) )
+RESULT( sum2( THIS, "_W2" ) )
 
 
 EQUATION( "c2" )
@@ -434,7 +682,7 @@ EQUATION( "c2" )
 Planned average unit cost in consumption-good sector
 */
 v[1] = V( "Q2" );
-RESULT( v[1] > 0 ? WHTAVE( "_c2", "_Q2" ) / v[1] : CURRENT )
+RESULT( v[1] > 0 ? wavg( THIS, "_c2", "_Q2" ) / v[1] : CURRENT )
 
 
 EQUATION( "c2e" )
@@ -442,7 +690,7 @@ EQUATION( "c2e" )
 Planned average unit cost in consumption-good sector
 */
 v[1] = V( "Q2e" );
-RESULT( v[1] > 0 ? WHTAVE( "_c2e", "_Q2e" ) / v[1] : CURRENT )
+RESULT( v[1] > 0 ? wavg( THIS, "_c2e", "_Q2e" ) / v[1] : CURRENT )
 
 
 EQUATION( "dCPI" )
@@ -463,44 +711,46 @@ EQUATION( "dNnom" )
 /*
 Change in total nominal inventories (currency terms)
 */
-RESULT( SUM( "_dNnom" ) )
+RESULT( sum2( THIS, "_dNnom" ) )
 
 
 EQUATION( "i2" )
 /*
 Interest paid by consumption-good sector
 */
-RESULT( SUM( "_i2" ) )
+RESULT( sum2( THIS, "_i2" ) )
 
 
 EQUATION( "iD2" )
 /*
 Interest received from deposits by consumption-good sector
 */
-RESULT( SUM( "_iD2" ) )
+RESULT( sum2( THIS, "_iD2" ) )
 
 
 EQUATION( "l2avg" )
 /*
 Average unfilled demand in consumption-good sector
 */
-v[1] = SUM( "_life2cycle" );
-RESULT( v[1] > 0 ? WHTAVE( "_l2", "_life2cycle" ) / v[1] : CURRENT )
+v[0] = wavg( THIS, "_l2", "_life2cycle", & v[1] );
+RESULT( v[1] > 0 ? v[0] / v[1] : CURRENT )
 
 
 EQUATION( "oldVint" )
 /*
 Oldest vintage (ID) in use in period by any firm in consumption-good sector
 */
-RESULT( MIN( "_oldVint" ) )
+V( "K" );										// ensure capital is deployed
+vintRegT *reg = & V_EXTS( PARENT, countryE, vint2reg );
+RESULT( reg->empty( ) ? 0 : reg->begin( )->first )
 
 
 EQUATION( "p2avg" )
 /*
 Average price charged in consumption-good sector
 */
-v[1] = SUM( "_life2cycle" );
-RESULT( v[1] > 0 ? WHTAVE( "_p2", "_life2cycle" ) / v[1] : CURRENT )
+v[0] = wavg( THIS, "_p2", "_life2cycle", & v[1] );
+RESULT( v[1] > 0 ? v[0] / v[1] : CURRENT )
 
 EQUATION( "emissions_c_avg" )
 /*
@@ -515,7 +765,8 @@ RESULT( AVE( "_emissions_c" ) )
 EQUATION( "f2rescale" )
 /*
 Rescale market shares in consumption-good sector to ensure adding to 1
-To be called after market shares are changed in '_f2' and 'entry2exit'
+To be called after market shares are changed in 'entry2exit', as 'Eavg'
+already rescales the shares computed in period
 */
 
 v[1] = SUM( "_f2" );							// add-up market shares
@@ -547,28 +798,31 @@ RESULT( v[0] )
 
 EQUATION( "firm2maps" )
 /*
-Updates the static maps of firms in consumption-good sector
+Refreshes the per-period data of firms in consumption-good sector
+The ID-indexed firm registry is updated on each entry/exit, so just invalidate
+the firm snapshot and fused reductions in period
 Only to be called if firm objects in sector 2 are created or destroyed
 */
 
-// clear vectors
-EXEC_EXTS( PARENT, countryE, firm2map, clear );
-EXEC_EXTS( PARENT, countryE, firm2ptr, clear );
+firm2_stale( PARENT );							// firm set changed
 
-i = 0;											// firm index in vector
-CYCLE( cur, "Firm2" )							// do for all firms in sector 2
-{
-	EXEC_EXTS( PARENT, countryE, firm2ptr, push_back, cur );// pointer to firm
-	EXEC_EXTS( PARENT, countryE, firm2map, insert, // save in firm's map
-			   firmPairT( ( int ) VS( cur, "_ID2" ), cur ) );
+RESULT( V_EXTS( PARENT, countryE, firm2reg ).n )
 
-	++i;
-}
 
-RESULT( i )
+/*============================= DUMMY EQUATIONS ==============================*/
 
+EQUATION_DUMMY( "D2iter", "D2" )
+/*
+Number of rationing rounds to allocate demand in consumption-good sector
+Zero in exact allocation, which has no rationing round
+Updated in 'D2'
+*/
 
-/*============================= DUMMY EQUATIONS ==============================*/
+EQUATION_DUMMY( "D2out", "D2" )
+/*
+Number of firms selling all available supply in consumption-good sector
+Updated in 'D2'
+*/
 
 EQUATION_DUMMY( "cEntry2", "" )
 /*
@@ -290,6 +290,10 @@ WRITE_EXT( countryE, macSta, SEARCH( "Mac" ) );
 WRITE_EXT( countryE, secSta, SEARCH( "Sec" ) );
 WRITE_EXT( countryE, labSta, SEARCH( "Lab" ) );
 
+// demand expectation kernel, as the rule does not change during a run
+WRITE_EXT( countryE, exp2kern,
+		   kern_expect2_sel( V( "flagExpect" ), & P_EXT( countryE )->exp2lags ) );
+
 // pointer shortcuts the access to individual market containers
 cur1 = CAPSECL0;
 cur2 = CONSECL0;
@@ -301,8 +305,6 @@ if ( COUNT( "Capital" ) > 1 || COUNT( "Consumption" ) > 1 ||
 	 COUNT( "Financial" ) > 1 || COUNT( "Labor" ) > 1 ||
 	 COUNT( "Stats" ) > 1 || COUNTS( cur1, "Firm1" ) > 1 ||
 	 COUNTS( cur2, "Firm2" ) > 1 ||
-	 COUNTS( SEARCHS( cur1, "Firm1" ), "Cli" ) > 1 ||
-	 COUNTS( SEARCHS( cur2, "Firm2" ), "Broch" ) > 1 ||
 	 COUNTS( SEARCHS( cur2, "Firm2" ), "Vint" ) > 1 )
 {
 	PLOG( "\n Error: multiple-instance objects not allowed, aborting!" );
@@ -350,7 +352,8 @@ double Eavg0 = ( VS( cur2, "omega1" ) + VS( cur2, "omega2" ) ) / 2;
 double G0 = V( "gG" ) * Ls0;					// initial public spending
 
 // reserve space for country-level non-initialized vectors
-EXEC_EXT( countryE, firm2ptr, reserve, F2 );	// sector 2 firm objects
+EXEC_EXT( countryE, firm2reg.slot, reserve, 2 * F2 );// sector 2 firm IDs
+EXEC_EXT( countryE, firm2reg.live, reserve, 2 * F2 );
 
 // reset serial ID counters for dynamic objects
 WRITES( cur1, "lastID1", 0 );
@@ -374,11 +377,11 @@ WRITELS( cur4, "w", INIWAGE, -1 );
 DELETE( SEARCHS( cur1, "Firm1" ) );				// remove empty firm instances
 DELETE( SEARCHS( cur2, "Firm2" ) );
 
-v[1] = entry_firm1( var, cur1, F1, true );		// add capital-good firms
+v[1] = entry_firm1( cur1, F1, true );			// add capital-good firms
 INIT_TSEARCHTS( cur1, "Firm1", F1 );			// prepare turbo search indexing
 
 v[1] += entry_firm2( var, cur2, F2, true );		// add consumer-good firms
-VS( cur2, "firm2maps" );						// update the mapping vectors
+VS( cur2, "firm2maps" );						// refresh firm data
 
 WRITEL( "Eq", v[1], -1 );						// save existing equity
 
@@ -193,38 +193,34 @@ RESULT( max( VS( PARENT, "d1" ) * ( V( "_Pi1" ) - V( "_Tax1" ) ), 0 ) )
 EQUATION( "_NC" )
 /*
 Number of new client firms in the period.
-Also creates the client-supplier connecting objects.
+Also creates the client-supplier connecting edges.
 */
 
-firmMapT firms = V_EXTS( GRANDPARENT, countryE, firm2map );// list with all firms
+int e;
+edgeStoreT *g = EDGESL2;						// supplier-client graph
+firmRegT *reg = & V_EXTS( GRANDPARENT, countryE, firm2reg );// all firms
 
-k = firms.size( );								// number of firms in sector 2
+k = reg->n;										// number of firms in sector 2
 h = V( "_HC" );									// number of historical clients
 
-CYCLE( cur, "Cli" )								// remove historical clients
-	firms.erase( ( int ) VS( cur, "__IDc" ) );
+vector < int > clients;							// historical clients IDs
+CYCLE_EDGES_S( g, V( "_ID1" ), e )
+	clients.push_back( g->e[ e ].IDc );
 
 i = ceil( VS( PARENT, "gamma" ) * h );			// new clients in period
-i = min( max( i, 1 ), min( k - h, firms.size( ) ) );// in [1, F2 - HC]
+i = min( max( i, 1 ), k - h );					// in [1, F2 - HC]
 
 j = max( 1, ceil( k / VS( PARENT, "F1" ) ) );	// firm fair share
 
 if ( h + i < j )								// ensure at least fair share
 	i = j - h;
 
-// build vector of all target firms (not yet clients)
-vector < firmPairT > targets( firms.begin( ), firms.end( ) );
+// draw distinct new clients among firms not yet clients
+objVecT targets;
+k = firm_reg_sample( reg, clients, i, targets );
 
-// draw new clients from target list, updating the list after each draw
-for ( k = 0; i > 0 && targets.size( ) > 0; --i, ++k )
-{
-	h = uniform_int( 0, targets.size( ) - 1 );	// draw a index in the list
-	firmPairT client = targets[ h ];			// retrieve drawn map pair
-	targets.erase( targets.begin( ) + h );		// remove drawn firm from list
-
-	// create the brochure/client interconnected objects
-	send_brochure( THIS, client.second );
-}
+for ( auto client : targets )					// create the supplier-client
+	send_brochure( THIS, client );				// graph edges
 
 RESULT( k )
 
@@ -297,9 +293,7 @@ else
 		}
 
 		// shrink or cancel all exceeding orders
-		CYCLE( cur, "Cli" )
-			if ( VS( cur, "__tOrd" ) == T )		// order in this period?
-				INCRS( cur, "__nCan", floor( VS( cur, "__nOrd" ) * v[11] ) );
+		order_cancel( EDGESL2, V( "_ID1" ), v[11], false );
 	}
 
 	update_debt( THIS, v[10], v[9] );			// update debt (desired/granted)
@@ -359,7 +353,9 @@ EQUATION( "_BC" )
 /*
 Number of buying clients for firm in capital-good sector
 */
-RESULT( COUNT_CND( "Cli", "__tOrd", "==", T ) )
+orderBookT *book = order_book( EDGESL2, V( "_ID1" ) );// period orders
+
+RESULT( book != NULL ? book->ord.size( ) : 0 )
 
 
 EQUATION( "_D1" )
@@ -367,28 +363,23 @@ EQUATION( "_D1" )
 Potential demand (orders) received by a firm in capital-good sector
 */
 VS( CONSECL2, "Id" );							// make sure all orders are sent
-RESULT( SUM_CND( "__nOrd", "__tOrd", "==", T ) )
+
+orderBookT *book = order_book( EDGESL2, V( "_ID1" ) );// period orders
+
+RESULT( book != NULL ? book->nOrd : 0 )
 
 
 EQUATION( "_HC" )
 /*
 Number of historical client firms from consumer-good sector.
-Also removes old, non-buying clients.
+Also removes old, non-buying clients (of all firms).
 */
 
-i = 0;											// client counter
-CYCLE_SAFE( cur, "Cli" )						// remove old clients
-{
-	if ( VS( cur, "__tSel" ) < T - 1 )			// last selection is old?
-	{
-		DELETE( SHOOKS( cur ) );				// remove supplier brochure entry
-		DELETE( cur );							// remove client entry
-	}
-	else
-		++i;
-}
+edgeStoreT *g = EDGESL2;
 
-RESULT( i )
+edge_expire( g );								// remove old clients
+
+RESULT( edge_deg( g->degS, V( "_ID1" ) ) )
 
 
 EQUATION( "_JO1" )
@@ -466,13 +457,7 @@ v[4] = V( "_L1dRD" );							// desired R&D workers
 v[5] = v[2] > v[4] ? 1 - ( v[1] - v[3] ) / ( v[2] - v[4] ) : 1;
 
 // adjust all pending orders, supplying at least one machine
-CYCLE( cur, "Cli" )
-	if ( VS( cur, "__tOrd" ) == T )				// order in this period?
-	{
-		v[6] = VS( cur, "__nOrd" ) - VS( cur, "__nCan" );// existing net orders
-		v[0] -= v[7] = min( floor( v[6] * v[5] ), v[6] - 1 );
-		INCRS( cur, "__nCan", v[7] );
-	}
+v[0] -= order_cancel( EDGESL2, V( "_ID1" ), v[5], true );
 
 RESULT( max( v[0], 0 ) )						// avoid negative in part. cases
 
@@ -44,95 +44,6 @@ Dividends to pay by firm in consumption-good sector
 RESULT( max( VS( PARENT, "d2" ) * ( V( "_Pi2" ) - V( "_Tax2" ) ), 0 ) )
 
 
-EQUATION( "_D2e" )
-/*
-Adaptive demand expectation of firm in consumer-good sector
-*/
-
-h = V( "_t2ent" );								// firm entry period
-k = VS( GRANDPARENT, "flagExpect" );			// expectation form
-j = ( k == 0 || k > 4 ) ? 1 : ( k == 1 ) ? 4 : 2;// req. number of data periods
-
-if ( h > 0 && h >= T - 1 - j )					// entrant or too few data?
-	END_EQUATION( CURRENT );
-
-// compute the mix between fulfilled and potential demand (orders)
-v[9] = VS( PARENT, "e0" );						// animal spirits parameter
-for ( i = 1; i <= j; ++i )
-{
-	v[10] = VL( "_D2", i );
-	v[ i ] = max( ( 1 - v[9] ) * v[10] + v[9] * VL( "_D2d", i ), v[10] );
-}
-
-switch ( k )
-{
-	// myopic expectations with 1-period memory
-	case 0:
-	default:
-		v[0] = v[1];
-		break;
-
-	// myopic expectations with up to 4-period memory
-	case 1:
-		v[11] = VS( PARENT, "e1" );				// weight of t-1 demand
-		v[12] = VS( PARENT, "e2" );				// weight of t-2 demand
-		v[13] = VS( PARENT, "e3" );				// weight of t-3 demand
-		v[14] = VS( PARENT, "e4" );				// weight of t-4 demand
-
-		for ( v[5] = v[6] = 0, i = 1; i <= 4; ++i )
-			if ( v[i] > 0 )						// consider only periods with demand
-			{
-				v[5] += v[ 10 + i ] * v[ i ];
-				v[6] += v[ 10 + i ];
-			}
-
-		v[0] = v[6] > 0 ? v[5] / v[6] : 0;		// rescale
-		break;
-
-	// accelerating GD expectations
-	case 2:
-		v[2] = max( v[2], 1 );					// floor to positive only
-
-		v[0] = ( 1 + VS( PARENT, "e5" ) * ( v[1] - v[2] ) / v[2] ) * v[1];
-		break;
-
-	// 1st order adaptive expectations
-	case 3:
-		v[0] = CURRENT + VS( PARENT, "e6" ) * ( v[1] - v[2] );
-		break;
-
-	// extrapolative-accelerating expectations
-	case 4:
-		v[2] = max( v[2], 1 );					// floor to positive only
-
-		v[0] = ( 1 + VS( PARENT, "e7" ) * ( v[1] - v[2] ) / v[2] +
-				 VS( PARENT, "e8" ) * VLS( GRANDPARENT, "dGDP", 1 ) ) * v[1];
-		break;
-}
-
-RESULT( v[0] )
-
-
-EQUATION( "_E" )
-/*
-Effective competitiveness of a firm in sector 2, considering the price,
-unfilled demand and the quality of the product for the consumer
-*/
-
-if ( V( "_life2cycle" ) == 0 )
-	END_EQUATION( VLS( PARENT, "Eavg", 1 ) );	// non-producing entrant
-
-v[1] = VLS( PARENT, "l2avg", 1 ) + 1;
-
-if ( V( "_emissions_c" ) > 0 ) {
-    v[2] = VS( PARENT, "omega3" ) * V( "_emissions_c" ) / VS( PARENT, "emissions_c_avg" );
-}
-
-RESULT( - VS( PARENT, "omega1" ) * V( "_p2" ) / VS( PARENT, "p2avg" ) -
-		VS( PARENT, "omega2" ) * ( v[1] > 1 ? ( VL( "_l2", 1 ) + 1 ) / v[1] : 1 ) -
-		v[2] )
-
-
 EQUATION( "_EI" )
 /*
 Effective expansion investment of firm in consumption-good sector
@@ -303,45 +214,54 @@ RESULT( v[0] )
 EQUATION( "_alloc2" )
 /*
 Allocate workers to vintages, prioritizing newer vintages
-Also updates '__Lvint'
+Also updates '__Lvint' and the output part of the firm vintage summary
 */
 
-cur = HOOK( TOPVINT );							// start with top vintage
-if ( cur == NULL )
-	END_EQUATION( 0 );							// no vintage, nothing to do
-
 V( "_c2" );										// ensure machines are set
+
+vintTabT *tab = vint_table( THIS );				// firm vintage table
+vintSumT *sum = & P_EXT( firm2E )->sum;			// firm vintage summary
+
+sum->Q = sum->E = 0;							// output and emissions
+
 v[1] = V( "_L2" );								// workers to allocate
-v[2] = VS( cur, "__LdVint" );					// labor demand of vintage
 
+k = tab->vint.size( );
+if ( k == 0 || v[1] <= 0 )						// no vintage or no worker?
+{
+	sum->tOut = T;
+	END_EQUATION( 0 );
+}
+
+// vintages newer than row i are fully staffed if their demand (firm total
+// less the cumulative demand up to row i) fits in the available workers,
+// so find the first such row i by binary search
+v[2] = tab->Ld[ k - 1 ];						// total labor demand
+i = lower_bound( tab->Ld.begin( ), tab->Ld.begin( ) + k, v[2] - v[1] ) -
+	tab->Ld.begin( );
+
+// as in the vintage chain walk, allocation stops at the first previous
+// vintage which was scrapped (chain gap) or has no machine to use
+for ( h = k - 1; h > i && tab->chain[ h ] && tab->toUse[ h - 1 ] > 0; --h );
+i = h;
+
+// row i gets the remaining workers, newer ones are fully staffed
 v[0] = 0;										// allocated worker counter
-while ( v[1] > 0 )								// allocate all available workers
+for ( ; i < k; ++i )
 {
-	while ( v[2] == 0 )							// find vintage with posit. dem.
-	{
-		cur = SHOOKS( cur );					// so go to the previous one
-		if ( cur == NULL || VS( cur, "__toUseVint" ) == 0 )// oldest or done?
-			goto done_alloc2;					// not possible to allocate more
+	v[3] = tab->Ld[ i ] - ( i > 0 ? tab->Ld[ i - 1 ] : 0 );// demand
+	v[4] = min( v[3], max( v[1] - ( v[2] - tab->Ld[ i ] ), 0 ) );// allocated
 
-		v[2] = VS( cur, "__LdVint" );			// labor demand of vintage
-	}
+	tab->L[ i ] = v[4];
+	WRITES( tab->vint[ i ], "__Lvint", v[4] );	// update vintage workers
 
-	if ( v[1] >= v[2] )							// can fully fulfill demand?
-	{
-		WRITES( cur, "__Lvint", v[2] );			// update available worker counter
-		v[1] -= v[2];
-		v[0] += v[2];
-		v[2] = 0;
-	}
-	else
-	{
-		WRITES( cur, "__Lvint", v[1] );			// supply what is available
-		v[0] += v[1];
-		v[1] = 0;
-	}
+	sum->Q += tab->A[ i ] * v[4];
+	sum->E += tab->A[ i ] * v[4] * tab->EA[ i ];
+
+	v[0] += v[4];
 }
 
-done_alloc2:
+sum->tOut = T;
 
 RESULT( v[0] )
 
@@ -350,7 +270,7 @@ EQUATION( "_c2" )
 /*
 Planned average unit cost of firm in consumption-good sector
 Considers even unused machines, as in original K+S
-Also updates '_A2'
+Also updates '_A2', '__toUseVint', '__Lvint'
 */
 
 v[1] = V( "_Q2d" );								// desired production
@@ -360,16 +280,18 @@ v[4] = VS( LABSUPL2, "w" );						// firm wage
 
 v[5] = max( floor( v[2] / v[3] ) - ceil( v[1] / v[3] ), 0 );// unused machines
 
+vintSumT *sum = vint_summary( THIS );			// firm vintage summary
+vintTabT *tab = vint_table( THIS );				// firm vintage table
+
+v[0] = v[4] * sum->nIA;							// machines cost
+v[6] = sum->n;									// machines
+v[7] = sum->nA;									// productivities
+
 // scan all vintages, from oldest to newest, preferring to use newer ones
-v[0] = v[6] = v[7] = 0;							// accumulators
-CYCLE( cur, "Vint" )							// choose vintages to use
+k = tab->vint.size( );
+for ( i = 0; i < k; ++i )						// choose vintages to use
 {
-	v[8] = VS( cur, "__nVint" );				// number of machines in vintage
-	v[9] = VS( cur, "__Avint" );				// vintage productivity
-
-	v[0] += v[8] * v[4] / v[9];					// add machines cost
-	v[6] += v[8];								// add machines
-	v[7] += v[8] * v[9];						// add productivities
+	v[8] = tab->n[ i ];							// number of machines in vintage
 
 	if ( v[5] >= v[8] )							// none to be used in the vint.?
 	{
@@ -382,14 +304,18 @@ CYCLE( cur, "Vint" )							// choose vintages to use
 		v[5] = 0;								// no more machine not to use
 	}
 
-	WRITES( cur, "__toUseVint", v[10] );		// number mach. to try to use
-	WRITES( cur, "__Lvint", 0 );				// no worker allocated yet
+	tab->toUse[ i ] = v[10];
+	tab->L[ i ] = 0;
+	tab->Ld[ i ] = ( i > 0 ? tab->Ld[ i - 1 ] : 0 ) +
+				   v[10] * v[3] / tab->A[ i ];// cumulative labor demand
+	WRITES( tab->vint[ i ], "__toUseVint", v[10] );// number mach. to try to use
+	WRITES( tab->vint[ i ], "__Lvint", 0 );		// no worker allocated yet
 }
 
 if ( v[6] == 0 )								// no machine?
 {
 	V( "_supplier" );							// ensure supplier is selected
-	cur1 = PARENTS( SHOOKS( HOOK( SUPPL ) ) );	// pointer to supplier
+	cur1 = supplier2( THIS );					// pointer to supplier
 
 	v[6] = 1;									// 1 notional machine
 	v[7] = VS( cur1, "_Atau" );					// new machines productivity
@@ -401,35 +327,6 @@ WRITE( "_A2", v[7] / v[6] );					// potential productivity
 RESULT( v[0] / v[6] )
 
 
-EQUATION( "_f2" )
-/*
-Market share of firm in consumption-good sector
-It is computed using a replicator equation over the relative competitiveness
-of the firm
-Because of entrants, market shares may add-up to more than one, so 'f2rescale'
-must be used before '_f2' is used, by calling 'CPI'
-*/
-
-if( V( "_life2cycle" ) == 0 )					// entrant firm state
-	END_EQUATION( 0 );
-
-v[1] = VS( PARENT, "f2min" );					// minimum share to stay
-
-if ( CURRENT == 0 && V( "_t2ent" ) == T - 2 )	// first-period entrant	?
-{
-	v[0] = VL( "_K", 1 ) / VLS( PARENT, "K", 1 );// same as capital share
-	END_EQUATION( max( v[0], v[1] ) );			// but over minimum
-}
-
-// replicator equation
-v[0] = VL( "_f2", 1 ) * ( 1 - VS( PARENT, "chi" ) *
-						  ( V( "_E" ) / VS( PARENT, "Eavg" ) - 1 ) );
-
-// lower-bounded slightly below exit threshold
-// to ensure firm sells production before leaving the market
-RESULT( max( v[0], 0.99 * v[1] ) )
-
-
 EQUATION( "_mu2" )
 /*
 Mark-up of firm in consumption-good sector
@@ -448,37 +345,32 @@ RESULT( CURRENT * ( 1 + VS( PARENT, "upsilon" ) * ( v[1] / v[2] - 1 ) ) )
 EQUATION( "_supplier" )
 /*
 Selected machine supplier by firm in consumption-good sector
-Also set firm 'hook' pointers to supplier firm object
+Also set firm current supplier edge in supplier-client graph
 */
 
-VS( CAPSECL2, "inn" );							// ensure innovation is done and
-												// brochures distributed
-v[1] = VS( PARENT, "m2" );						// machine modularity
-v[2] = VS( PARENT, "b" );						// required payback period
+edgeStoreT *g = EDGESL2;						// supplier-client graph
+offerTabT *off = offer_table( GRANDPARENT );	// supplier offers in period
 
 v[4] = DBL_MAX;									// supplier price/cost ratio
 i = 0;
-cur2 = cur3 = NULL;
-CYCLE( cur, "Broch" )							// use brochures to find supplier
+h = -1;											// best supplier edge
+CYCLE_EDGES_C( g, V( "_ID2" ), j )				// use brochures to find supplier
 {
-	cur1 = PARENTS( SHOOKS( cur ) );			// pointer to supplier object
-
 	// compare total machine unit cost (acquisition + operation for payback period)
-	v[5] = VS( cur1, "_p1" ) / v[1] + VS( cur1, "_cTau" ) * v[2];
+	v[5] = off->cost[ g->e[ j ].IDs ];
 	if ( v[5] < v[4] )							// best so far?
 	{
 		v[4] = v[5];							// save current best supplier
-		i = VS( cur1, "_ID1" );					// supplier ID
-		cur2 = SHOOKS( cur );					// own entry on supplier list
-		cur3 = cur;								// best supplier brochure
+		i = g->e[ j ].IDs;						// supplier ID
+		h = j;									// best supplier edge
 	}
 }
 
 // if supplier is found, simply update it, if not, draw a random one
-if ( cur2 != NULL && cur3 != NULL )
+if ( h >= 0 )
 {
-	WRITES( cur2, "__tSel", T );				// update selection time
-	WRITE_HOOK( SUPPL, cur3 );					// pointer to current brochure
+	edge_touch( g, h );							// update selection time
+	P_EXT( firm2E )->supEdge = h;				// current supplier edge
 }
 else											// no brochure received
 {
@@ -498,18 +390,18 @@ Canceled investment of firm in consumption-good sector
 
 V( "_supplier" );								// ensure new supplier is set
 
-cur = HOOK( SUPPL );							// pointer to current supplier
-VS( PARENTS( SHOOKS( cur ) ), "_Q1e" );			// make sure supplier produced
+edgeT *sup = sup_edge( THIS );					// current supplier edge
+VS( sup->sup, "_Q1e" );							// make sure supplier produced
 
-v[1] = VS( SHOOKS( cur ), "__nCan" );			// canceled machine number
-k = VS( SHOOKS( cur ), "__tOrd" );				// time of canceled order
+v[1] = sup->nCan;								// canceled machine number
+k = sup->tOrd;									// time of canceled order
 
 if ( k == T && v[1] > 0 )
 {
 	v[2] = VS( PARENT, "m2" );					// machine output per period
 	v[3] = V( "_SI" ) / v[2];					// machines to substitute
 	v[4] = V( "_EI" ) / v[2];					// machines to expand
-	v[5] = VS( PARENTS( SHOOKS( cur ) ), "_p1" );// machine price
+	v[5] = VS( sup->sup, "_p1" );				// machine price
 
 	if ( v[1] > v[3] )							// no space for substitution?
 	{
@@ -534,7 +426,7 @@ EQUATION( "_D2d" )
 Desired (potential) demand for firm in consumption-good sector
 */
 VS( PARENT, "CPI" );							// ensure m.s. updated
-RESULT( V( "_f2" ) * VS( PARENT, "D2d" ) )
+RESULT( V( "_f2d" ) * VS( PARENT, "D2d" ) )
 
 
 EQUATION( "_Inom" )
@@ -544,14 +436,9 @@ Investment (nominal/currency terms) of firm in consumption-good sector
 
 V( "_K" );										// ensure capital is deployed
 
-cur = HOOK( TOPVINT );							// last capital vintage
+firm2E *ext = P_EXT( firm2E );					// new vintage may be merged
 
-if ( cur != NULL && VS( cur, "__tVint" ) == T )	// capital deployed in period?
-	v[0] = VS( cur, "__nVint" ) * VS( cur, "__pVint" );
-else
-	v[0] = 0;
-
-RESULT( v[0] )
+RESULT( ext->tInom == T ? ext->Inom : 0 )		// capital deployed in period?
 
 
 EQUATION( "_JO2" )
@@ -578,7 +465,12 @@ if ( v[2] + v[3] > 0 )
 	v[4] = floor( ( v[2] + v[3] ) / v[1] );		// total number of new machines
 
 	if ( v[4] > 0 )								// new machines to install?
+	{
 		add_vintage( THIS, v[4], false );		// create vintage
+
+		if ( VS( GRANDPARENT, "flagVintMerge" ) != 0 )// compact vintages?
+			merge_vintage( var, THIS );
+	}
 }
 
 v[5] = max( VL( "_K", 1 ) + v[3] - V( "_Kd" ), 0 );// desired capital shrinkage
@@ -586,11 +478,18 @@ v[6] = floor( v[5] / v[1] );					// machines to remove from K
 
 v[7] = floor( v[2] / v[1] );					// machines to substitute in K
 
-j = T + 1;										// oldest vintage so far
-h = 0;											// oldest vintage ID
-CYCLE_SAFE( cur, "Vint" )						// search from older vintages
+vintTabT *tab = vint_table( THIS );				// firm vintage table
+cur1 = HOOK( TOPVINT );							// last vintage is never removed
+
+// plan scrapping from older vintages (rows in build time order) without
+// changing any vintage, to be applied in a single batch afterwards
+vintActVecT acts;								// planned vintage changes
+k = tab->vint.size( );
+for ( i = 0; i < k; ++i )
 {
+	cur = tab->vint[ i ];
 	v[8] = VS( cur, "__RSvint" );				// number of machines to scrap
+	v[9] = -1;									// new vintage size (-1: keep)
 
 	if ( v[8] < 0 )								// end-of-life vintage to scrap?
 	{
@@ -602,19 +501,21 @@ CYCLE_SAFE( cur, "Vint" )						// search from older vintages
 			{
 				v[8] -= v[6];					// just reduce vintage
 				v[6] = 0;						// shrinkage done
-				WRITES( cur, "__nVint", v[8] );
+				v[9] = v[8];
 			}
 			else								// scrap entire vintage
 			{
-				if ( scrap_vintage( var, cur ) >= 0 )// not last vintage?
+				if ( cur != cur1 )				// not last vintage?
 				{
 					v[6] -= v[8];
-					continue;					// don't consider for old vint.
+					acts.push_back( { i, 0 } );
+					continue;
 				}
 				else
 				{
 					v[8] = 0;					// last: nothing else to scrap
 					v[6] -= v[8] - 1;
+					v[9] = 1;					// keep just 1 machine
 				}
 			}
 		}
@@ -627,29 +528,32 @@ CYCLE_SAFE( cur, "Vint" )						// search from older vintages
 		{
 			v[8] -= v[7];						// just reduce vintage
 			v[7] = 0;							// substitution done
-			WRITES( cur, "__nVint", v[8] );
+			v[9] = v[8];
 		}
 		else									// scrap entire vintage
 		{
-			if ( scrap_vintage( var, cur ) >= 0 )// not last vintage?
+			if ( cur != cur1 )					// not last vintage?
 			{
 				v[7] -= v[8];
-				continue;						// don't consider for old vint.
+				acts.push_back( { i, 0 } );
+				continue;
 			}
+			else
+				v[9] = 1;						// keep just 1 machine
 		}
 	}
 
-	i = VS( cur, "__tVint" );					// time of vintage install
-	if ( i < j )								// oldest so far?
-	{
-		j = i;
-		h = VS( cur, "__IDvint" );				// save oldest
-	}
+	if ( v[9] >= 0 )							// vintage to shrink?
+		acts.push_back( { i, v[9] } );
 }
 
-WRITE( "_oldVint", h );
+scrap_vintages( var, THIS, & acts );			// apply scrapping plan
+
+vintSumT *sum = vint_summary( THIS );			// summary of remaining vintages
 
-RESULT( SUM( "__nVint" ) * v[1] )
+WRITE( "_oldVint", sum->old != NULL ? VS( sum->old, "__IDvint" ) : 0 );
+
+RESULT( sum->n * v[1] )
 
 
 EQUATION( "_Knom" )
@@ -657,7 +561,7 @@ EQUATION( "_Knom" )
 Current capital (nominal/currency terms) of firm in consumption-good sector
 */
 V( "_K" );										// ensure capital is deployed
-RESULT( WHTAVE( "__nVint", "__pVint" ) )
+RESULT( vint_summary( THIS )->nP )
 
 
 EQUATION( "_L2" )
@@ -698,14 +602,15 @@ EQUATION( "_Q2e" )
 /*
 Effective output of firm in consumption-good sector
 */
-RESULT( min( V( "_Q2" ), SUM( "__Qvint" ) ) )
+V( "_alloc2" );									// ensure allocation is done
+RESULT( min( V( "_Q2" ), vint_summary_out( THIS )->Q ) )
 
 EQUATION( "_emissions_c" )
 /*
 Carbon emissions produced by firm in consumption-good sector
 */
-
-RESULT ( SUM( "__Evint" ) )
+V( "_alloc2" );									// ensure allocation is done
+RESULT( vint_summary_out( THIS )->E )
 
 
 EQUATION( "_Q2p" )
@@ -713,7 +618,7 @@ EQUATION( "_Q2p" )
 Potential production with current machines for a firm in
 consumption-good sector
 */
-RESULT( SUM( "__nVint" ) * VS( PARENT, "m2" ) )
+RESULT( vint_summary( THIS )->n * VS( PARENT, "m2" ) )
 
 
 EQUATION( "_Q2pe" )
@@ -747,16 +652,7 @@ Desired substitution investment of firm in consumption-good sector
 
 v[1] = VS( PARENT, "m2" );						// machine output per period
 
-v[2] = 0;										// scrapped machine accumulator
-CYCLE( cur1, "Vint" )							// search last vintage to scrap
-{
-	v[3] = VS( cur1, "__RSvint" );				// number of machines to scrap
-
-	if ( v[3] == 0 )							// nothing else to do
-		break;
-
-	v[2] += abs( v[3] );						// accumulate vintage
-}
+v[2] = vint_summary_RS( THIS )->RSpre;			// machines to scrap
 
 v[4] = max( VL( "_K", 1 ) - V( "_Kd" ), 0 );	// capital shrinkage desired?
 v[5] = floor( v[4] / v[1] );					// machines to remove from K
@@ -871,12 +767,25 @@ Demand fulfilled by firm in consumption-good sector
 Updated in 'D2'
 */
 
+EQUATION_DUMMY( "_D2e", "D2e" )
+/*
+Adaptive demand expectation of firm in consumer-good sector
+Updated in 'D2e'
+*/
+
 EQUATION_DUMMY( "_Deb2", "" )
 /*
 Stock of bank debt of firm in consumption-good sector
 Updated in '_Q2', '_EI', '_SI', '_Tax2'
 */
 
+EQUATION_DUMMY( "_E", "Eavg" )
+/*
+Effective competitiveness of a firm in sector 2, considering the price,
+unfilled demand and the emissions of the product for the consumer
+Updated in 'Eavg'
+*/
+
 EQUATION_DUMMY( "_NW2", "" )
 /*
 Net worth of firm in consumption-good sector
@@ -889,6 +798,22 @@ Provision for production of firm in consumption-good sector
 Updated in '_Q2'
 */
 
+EQUATION_DUMMY( "_f2", "Eavg" )
+/*
+Market share of firm in consumption-good sector
+It is computed using a replicator equation over the relative competitiveness
+of the firm, and rescaled to add-up to one
+Updated in 'Eavg'
+*/
+
+EQUATION_DUMMY( "_f2d", "Eavg" )
+/*
+Demand share of firm in consumption-good sector
+The market share or, if household segments are enabled, the budget-weighted
+average of the segment shares
+Updated in 'Eavg'
+*/
+
 EQUATION_DUMMY( "_l2", "" )
 /*
 Unfilled demand of firm in consumption-good sector
@@ -140,7 +140,7 @@ EQUATION( "HH1" )
 Normalized Herfindahl-Hirschman index for capital-good sector
 */
 i = COUNTS( CAPSECL2, "Firm1" );
-RESULT( i > 1 ? max( 0, ( WHTAVES( CAPSECL2, "_f1", "_f1" ) - 1.0 / i ) /
+RESULT( i > 1 ? max( 0, ( wavg( CAPSECL2, "_f1", "_f1" ) - 1.0 / i ) /
 						( 1 - 1.0 / i ) ) : 1 )
 
 
@@ -246,7 +246,7 @@ EQUATION( "HH2" )
 Normalized Herfindahl-Hirschman index for consumption-good sector
 */
 i = COUNTS( CONSECL2, "Firm2" );
-RESULT( i > 1 ? max( 0, ( WHTAVES( CONSECL2, "_f2", "_f2" ) - 1.0 / i ) /
+RESULT( i > 1 ? max( 0, ( wavg( CONSECL2, "_f2", "_f2" ) - 1.0 / i ) /
 						( 1 - 1.0 / i ) ) : 1 )
 
 
@@ -262,6 +262,47 @@ CYCLES( CONSECL2, cur, "Firm2" )
 RESULT( v[0] )
 
 
+EQUATION( "Kage2avg" )
+/*
+Average age of machines in consumption-good sector
+*/
+VS( CONSECL2, "K" );							// ensure capital is deployed
+
+v[0] = v[1] = 0;
+vintAgeT *age = & V_EXTS( GRANDPARENT, countryE, vint2age );
+for ( auto itr = age->begin( ); itr != age->end( ); ++itr )
+{
+	v[0] += itr->second * ( T - itr->first );
+	v[1] += itr->second;
+}
+
+RESULT( v[1] > 0 ? v[0] / v[1] : 0 )
+
+
+EQUATION( "Kage2max" )
+/*
+Age of oldest machines in consumption-good sector
+*/
+VS( CONSECL2, "K" );							// ensure capital is deployed
+RESULT( vint_age_quant( GRANDPARENT, 1 ) )
+
+
+EQUATION( "Kage2med" )
+/*
+Median age of machines in consumption-good sector
+*/
+VS( CONSECL2, "K" );							// ensure capital is deployed
+RESULT( vint_age_quant( GRANDPARENT, 0.5 ) )
+
+
+EQUATION( "Kage2p90" )
+/*
+Age of the 10% oldest machines in consumption-good sector
+*/
+VS( CONSECL2, "K" );							// ensure capital is deployed
+RESULT( vint_age_quant( GRANDPARENT, 0.9 ) )
+
+
 EQUATION( "L2larg" )
 /*
 Number of workers of largest firm in consumption-good sector
@@ -303,7 +344,7 @@ EQUATION( "mu2avg" )
 /*
 Weighted average mark-up of consumption-good sector
 */
-RESULT( WHTAVES( CONSECL2, "_mu2", "_f2" ) )
+RESULT( wavg( CONSECL2, "_mu2", "_f2" ) )
 
 
 EQUATION( "nBrochAvg" )
@@ -311,11 +352,9 @@ EQUATION( "nBrochAvg" )
 Average number of machine brochures available to firms in consumer-good sector
 */
 
-v[0] = 0;
-CYCLES( CONSECL2, cur, "Firm2" )
-	v[0] += COUNTS( cur, "Broch");
+edgeStoreT *g = EDGESL2;						// supplier-client graph
 
-RESULT( v[0] / VS( CONSECL2, "F2" ) )
+RESULT( ( g->e.size( ) - g->freeE.size( ) ) / VS( CONSECL2, "F2" ) )
 
 
 /*============================= LABOR STATS ==================================*/
@@ -357,11 +396,7 @@ EQUATION( "_RS2" )
 Number of machines to scrap of firm in consumption-good sector
 */
 
-v[0] = 0;
-CYCLE( cur, "Vint" )
-	v[0] += abs( VS( cur, "__RSvint" ) );
-
-RESULT( v[0] )
+RESULT( vint_summary_RS( THIS )->RSall )
 
 
 /*============================= DUMMY EQUATIONS ==============================*/
@@ -172,25 +172,1174 @@ double cash_flow( object *firm, double profit, double tax )
 }
 
 
-/*================== CAPITAL MANAGEMENT SUPPORT C FUNCTIONS ==================*/
+/*====================== VECTOR KERNEL SUPPORT C FUNCTIONS ===================*/
+
+#ifdef __AVX2__
+#include <immintrin.h>							// AVX2 intrinsics
+#endif
+
+// dot and triple products of contiguous arrays over the range [i0, i1)
+// independent lanes let the compiler use SIMD without changing FP semantics
+
+double kern_dot( const double *x, const double *y, int i0, int i1 )
+{
+	double s[ VLANES ] = { 0 };
+	int i, j;
+
+	for ( i = i0; i + VLANES <= i1; i += VLANES )
+		for ( j = 0; j < VLANES; ++j )
+			s[ j ] += x[ i + j ] * y[ i + j ];
+
+	for ( ; i < i1; ++i )
+		s[ 0 ] += x[ i ] * y[ i ];
+
+	for ( j = 1; j < VLANES; ++j )
+		s[ 0 ] += s[ j ];
+
+	return s[ 0 ];
+}
+
+
+double kern_dot3( const double *x, const double *y, const double *z,
+				  int i0, int i1 )
+{
+	double s[ VLANES ] = { 0 };
+	int i, j;
+
+	for ( i = i0; i + VLANES <= i1; i += VLANES )
+		for ( j = 0; j < VLANES; ++j )
+			s[ j ] += x[ i + j ] * y[ i + j ] * z[ i + j ];
+
+	for ( ; i < i1; ++i )
+		s[ 0 ] += x[ i ] * y[ i ] * z[ i ];
+
+	for ( j = 1; j < VLANES; ++j )
+		s[ 0 ] += s[ j ];
+
+	return s[ 0 ];
+}
+
+
+// consumption-good market rationing kernels over the firm snapshot arrays
+// (share f, price p, available supply s, fulfilled d and unsatisfied demand
+// l), using AVX2 (4 lanes, sold-out firms masked) when available
+
+// one round of the iterative rationing of $ demand M (reference mode)
+// firms (lanes) supplying all demanded keep share and have supply reduced,
+// the other ones sell all supply and drop out (zero share and supply)
+// return $ demand allocated, and update share yet unallocated in fLeft
+
+double kern_ration_round( int n, double M, double *f, const double *p,
+						  double *s, double *d, double *l, bool first,
+						  double *fLeft )
+{
+	double dem, spent = 0;
+	int i = 0;
+
+	*fLeft = 0;
+
+#ifdef __AVX2__
+	__m256d zero = _mm256_setzero_pd( ), vM = _mm256_set1_pd( M ),
+			vSpent = zero, vLeft = zero;
+
+	for ( ; i + 4 <= n; i += 4 )
+	{
+		__m256d vf = _mm256_loadu_pd( f + i ), vp = _mm256_loadu_pd( p + i ),
+				vs = _mm256_loadu_pd( s + i ), vd = _mm256_loadu_pd( d + i );
+
+		__m256d act = _mm256_and_pd( _mm256_cmp_pd( vf, zero, _CMP_GT_OQ ),
+									 _mm256_cmp_pd( vs, zero, _CMP_GT_OQ ) );
+		__m256d vDemM = _mm256_mul_pd( vM, vf );
+		__m256d vDem = _mm256_div_pd( vDemM, vp );
+		__m256d fits = _mm256_and_pd( act,
+									  _mm256_cmp_pd( vDem, vs, _CMP_LE_OQ ) );
+		__m256d cap = _mm256_andnot_pd( fits, act );
+
+		vd = _mm256_add_pd( vd, _mm256_or_pd( _mm256_and_pd( fits, vDem ),
+											  _mm256_and_pd( cap, vs ) ) );
+		vSpent = _mm256_add_pd( vSpent,
+					_mm256_or_pd( _mm256_and_pd( fits, vDemM ),
+								  _mm256_and_pd( cap, _mm256_mul_pd( vs, vp ) ) ) );
+		vLeft = _mm256_add_pd( vLeft, _mm256_and_pd( fits, vf ) );
+
+		if ( first )
+		{
+			__m256d vl = _mm256_loadu_pd( l + i );
+			vl = _mm256_blendv_pd( vl, _mm256_sub_pd( vDem, vs ), cap );
+			_mm256_storeu_pd( l + i, vl );
+		}
+
+		_mm256_storeu_pd( d + i, vd );
+		_mm256_storeu_pd( s + i, _mm256_blendv_pd(
+							_mm256_andnot_pd( cap, vs ),
+							_mm256_sub_pd( vs, vDem ), fits ) );
+		_mm256_storeu_pd( f + i, _mm256_and_pd( fits, vf ) );
+	}
+
+	double lanes[ 4 ];
+	_mm256_storeu_pd( lanes, vSpent );
+	spent = lanes[ 0 ] + lanes[ 1 ] + lanes[ 2 ] + lanes[ 3 ];
+	_mm256_storeu_pd( lanes, vLeft );
+	*fLeft = lanes[ 0 ] + lanes[ 1 ] + lanes[ 2 ] + lanes[ 3 ];
+#endif
+
+	for ( ; i < n; ++i )						// scalar path or remainder
+	{
+		if ( f[ i ] > 0 && s[ i ] > 0 )			// firm has demand to supply
+		{
+			dem = M * f[ i ] / p[ i ];			// firm # demand allocation
+
+			if ( dem <= s[ i ] )				// can supply all demanded?
+			{
+				d[ i ] += dem;
+				spent += M * f[ i ];
+				*fLeft += f[ i ];
+				s[ i ] -= dem;
+				continue;
+			}
+
+			if ( first )						// unsatisfied demand metric
+				l[ i ] = dem - s[ i ];
+
+			d[ i ] += s[ i ];					// supply all # available
+			spent += s[ i ] * p[ i ];
+		}
+
+		f[ i ] = s[ i ] = 0;					// nothing else to supply
+	}
+
+	return spent;
+}
+
+
+// fulfilled and unsatisfied demand for a $ demand M, when each firm sells the
+// minimum between available supply and its share of the demand level lambda
+// (exact allocation mode)
+
+void kern_ration_fill( int n, double M, double lambda, const double *f,
+					   const double *p, const double *s, double *d, double *l )
+{
+	int i = 0;
+
+#ifdef __AVX2__
+	__m256d zero = _mm256_setzero_pd( ), vM = _mm256_set1_pd( M ),
+			vLam = _mm256_set1_pd( lambda );
+
+	for ( ; i + 4 <= n; i += 4 )
+	{
+		__m256d vf = _mm256_loadu_pd( f + i ), vp = _mm256_loadu_pd( p + i ),
+				vs = _mm256_loadu_pd( s + i );
+
+		__m256d act = _mm256_and_pd( _mm256_cmp_pd( vf, zero, _CMP_GT_OQ ),
+									 _mm256_cmp_pd( vs, zero, _CMP_GT_OQ ) );
+		__m256d vfp = _mm256_div_pd( vf, vp );
+
+		_mm256_storeu_pd( d + i, _mm256_and_pd( act,
+						  _mm256_min_pd( vs, _mm256_mul_pd( vLam, vfp ) ) ) );
+		_mm256_storeu_pd( l + i, _mm256_and_pd( act,
+						  _mm256_max_pd( _mm256_sub_pd( _mm256_mul_pd( vM, vfp ),
+														vs ), zero ) ) );
+	}
+#endif
+
+	for ( ; i < n; ++i )						// scalar path or remainder
+		if ( f[ i ] > 0 && s[ i ] > 0 )			// firm has demand to supply
+		{
+			d[ i ] = min( s[ i ], lambda * f[ i ] / p[ i ] );
+			l[ i ] = max( M * f[ i ] / p[ i ] - s[ i ], 0 );
+		}
+		else
+			d[ i ] = l[ i ] = 0;
+}
+
+
+// demand expectation kernels of firms in sector 2, specialized per expectation
+// rule ('flagExpect'), over the n firms with lag-major arrays of past fulfilled
+// (D) and potential (Dd) demands (D[ ( i - 1 ) * n + j ] is lag i of firm j)
+// and past expectations (cur)
+
+template < int RULE >
+void kern_expect2( int n, const double *D, const double *Dd, const double *cur,
+				   const expect2ParT &par, double *out )
+{
+	const int lags = RULE == 1 ? 4 : RULE == 0 ? 1 : 2;
+	const double e0 = par.e[ 0 ];
+	double m[ 4 ];
+
+	for ( int j = 0; j < n; ++j )
+	{
+		// mix between fulfilled and potential demand (orders)
+		for ( int i = 0; i < lags; ++i )
+			m[ i ] = max( ( 1 - e0 ) * D[ i * n + j ] + e0 * Dd[ i * n + j ],
+						  D[ i * n + j ] );
+
+		if ( RULE == 0 )						// myopic, 1-period memory
+			out[ j ] = m[ 0 ];
+
+		if ( RULE == 1 )						// myopic, up to 4-period memory
+		{
+			double s = 0, w = 0;
+
+			for ( int i = 0; i < 4; ++i )		// only periods with demand
+			{
+				s += m[ i ] > 0 ? par.e[ i + 1 ] * m[ i ] : 0;
+				w += m[ i ] > 0 ? par.e[ i + 1 ] : 0;
+			}
+
+			out[ j ] = w > 0 ? s / w : 0;		// rescale
+		}
+
+		if ( RULE == 2 || RULE == 4 )			// accelerating expectations
+		{
+			double m2 = max( m[ 1 ], 1.0 );		// floor to positive only
+			double acc = 1 + par.e[ RULE == 2 ? 5 : 7 ] * ( m[ 0 ] - m2 ) / m2;
+
+			if ( RULE == 4 )					// extrapolative part
+				acc += par.e[ 8 ] * par.dGDP;
+
+			out[ j ] = acc * m[ 0 ];
+		}
+
+		if ( RULE == 3 )						// 1st order adaptive
+			out[ j ] = cur[ j ] + par.e[ 6 ] * ( m[ 0 ] - m[ 1 ] );
+	}
+}
+
+
+// select the demand expectation kernel for an expectation rule, and the
+// number of past periods it requires
+
+expect2KernT kern_expect2_sel( int rule, int *lags )
+{
+	switch ( rule )
+	{
+		case 1:
+			*lags = 4;
+			return kern_expect2 < 1 >;
+		case 2:
+			*lags = 2;
+			return kern_expect2 < 2 >;
+		case 3:
+			*lags = 2;
+			return kern_expect2 < 3 >;
+		case 4:
+			*lags = 2;
+			return kern_expect2 < 4 >;
+		case 0:
+		default:
+			*lags = 1;
+			return kern_expect2 < 0 >;
+	}
+}
+
+
+/*==================== VINTAGE TABLE SUPPORT C FUNCTIONS =====================*/
+
+// get the vintage table of a consumption-good firm in equations '_c2',
+// '_alloc2', '_K' and the vintage support functions
+// the table is the authoritative copy of the firm vintages: rows are changed
+// in place by 'add_vintage', 'vint_resize', 'scrap_vintages' and
+// 'merge_vintage', which write only the changed values back to LSD
+
+vintTabT *vint_table( object *firm )
+{
+	return & P_EXTS( firm, firm2E )->tab;
+}
+
+
+// append a new vintage object as the newest row of a firm vintage table, with
+// no machine to use yet, in function 'add_vintage'
+
+void vint_row_add( vintTabT *tab, object *vint, double n, double A, double p,
+				   double tV, bool chain )
+{
+	tab->n.push_back( n );
+	tab->A.push_back( A );
+	tab->p.push_back( p );
+	tab->tV.push_back( tV );
+	tab->EA.push_back( VS( vint, "__EAvint" ) );// fixed, set in configuration
+	tab->toUse.push_back( 0 );
+	tab->L.push_back( 0 );
+	tab->Ld.push_back( tab->Ld.empty( ) ? 0 : tab->Ld.back( ) );
+	tab->chain.push_back( chain );
+	tab->vint.push_back( vint );
+}
+
+
+// copy row i of a firm vintage table over row j (j <= i) and keep only the
+// first k rows, in functions 'scrap_vintages', 'merge_vintage'
+
+void vint_row_copy( vintTabT *tab, int i, int j )
+{
+	tab->n[ j ] = tab->n[ i ];
+	tab->A[ j ] = tab->A[ i ];
+	tab->p[ j ] = tab->p[ i ];
+	tab->tV[ j ] = tab->tV[ i ];
+	tab->EA[ j ] = tab->EA[ i ];
+	tab->toUse[ j ] = tab->toUse[ i ];
+	tab->L[ j ] = tab->L[ i ];
+	tab->Ld[ j ] = tab->Ld[ i ];
+	tab->chain[ j ] = tab->chain[ i ];
+	tab->vint[ j ] = tab->vint[ i ];
+}
+
+
+void vint_rows_keep( vintTabT *tab, int k )
+{
+	tab->n.resize( k );
+	tab->A.resize( k );
+	tab->p.resize( k );
+	tab->tV.resize( k );
+	tab->EA.resize( k );
+	tab->toUse.resize( k );
+	tab->L.resize( k );
+	tab->Ld.resize( k );
+	tab->chain.resize( k );
+	tab->vint.resize( k );
+}
+
+
+// recompute the cumulative labor demand of a firm vintage table from row i
+// on, after rows are removed or merged, in functions 'scrap_vintages',
+// 'merge_vintage'
+
+void vint_rows_Ld( object *firm, vintTabT *tab, int i )
+{
+	double m2 = VS( PARENTS( firm ), "m2" );
+
+	for ( ; i < ( int ) tab->vint.size( ); ++i )
+		tab->Ld[ i ] = ( i > 0 ? tab->Ld[ i - 1 ] : 0 ) +
+					   tab->toUse[ i ] * m2 / tab->A[ i ];
+}
+
+
+// mark the vintage summary of a firm as outdated in functions 'add_vintage',
+// 'vint_resize', 'scrap_vintages', 'merge_vintage'
+
+void vint_stale( object *firm )
+{
+	firm2E *ext = P_EXTS( firm, firm2E );
+
+	ext->sum.t = ext->sum.tRS = ext->sum.tOut = -1;
+}
+
+
+// add (sign=1) or remove (sign=-1) a vintage to/from the running capital
+// stock totals of a consumption-good firm in functions 'add_vintage',
+// 'scrap_vintages', 'vint_resize', 'merge_vintage', 'exit_firms', taking
+// the vintage from row i of the firm vintage table
+
+void vint_tot_add( object *firm, int i, double sign )
+{
+	firm2E *ext = P_EXTS( firm, firm2E );
+	vintTabT *tab = & ext->tab;
+	vintTotT *tot = & ext->tot;
+	double n = sign * tab->n[ i ];
+	double A = tab->A[ i ];
+
+	if ( n == 0 )								// empty vintage?
+		return;
+
+	tot->n += n;
+	tot->nA += n * A;
+	tot->nP += n * tab->p[ i ];
+	tot->nIA += n / A;
+	tot->nAEA += n * A * tab->EA[ i ];
+
+	// update sector machine-age histogram
+	vintAgeT *age = & V_EXTS( GRANDPARENTS( firm ), countryE, vint2age );
+	int tV = tab->tV[ i ];
+
+	if ( ( ( *age )[ tV ] += n ) < 0.5 )		// no machine left of period?
+		age->erase( tV );
+}
+
+
+// get the machine age in the consumption-good sector of a country at the
+// quantile q (0=newest, 1=oldest), from the machine-age histogram, in
+// equations 'Kage2max', 'Kage2med', 'Kage2p90'
+
+double vint_age_quant( object *cntry, double q )
+{
+	double n = 0, nTot = 0;
+	vintAgeT *age = & V_EXTS( cntry, countryE, vint2age );
+
+	if ( age->empty( ) )
+		return 0;
+
+	for ( auto itr = age->begin( ); itr != age->end( ); ++itr )
+		nTot += itr->second;
+
+	for ( auto itr = age->rbegin( ); itr != age->rend( ); ++itr )
+		if ( ( n += itr->second ) >= q * nTot )
+			return T - itr->first;
+
+	return T - age->begin( )->first;
+}
+
+
+// change the number of machines in the vintage in row i of the vintage table
+// of a consumption-good firm in function 'scrap_vintages'
+
+void vint_resize( object *firm, int i, double n )
+{
+	vintTabT *tab = vint_table( firm );
+
+	vint_tot_add( firm, i, -1 );				// remove old size
+	tab->n[ i ] = n;
+	WRITES( tab->vint[ i ], "__nVint", n );		// write back to LSD
+	vint_tot_add( firm, i, 1 );					// add new size
+
+	vint_stale( firm );							// update vintage summary
+}
+
+
+#ifdef CHECK_VINT_TOT
+
+// compare the running capital stock totals and the vintage table of a
+// consumption-good firm with a full scan of its vintages in function
+// 'vint_summary'
+
+void vint_tot_check( object *firm )
+{
+	int i = 0;
+	double n, A, nA = 0, nAEA = 0, nIA = 0, nP = 0, nTot = 0;
+	object *cur;
+	vintTabT *tab = vint_table( firm );
+	vintTotT *tot = & P_EXTS( firm, firm2E )->tot;
+
+	CYCLES( firm, cur, "Vint" )
+	{
+		if ( i >= ( int ) tab->vint.size( ) || tab->vint[ i ] != cur ||
+			 tab->n[ i ] != VS( cur, "__nVint" ) ||
+			 tab->A[ i ] != VS( cur, "__Avint" ) ||
+			 tab->p[ i ] != VS( cur, "__pVint" ) ||
+			 tab->tV[ i ] != VS( cur, "__tVint" ) ||
+			 tab->toUse[ i ] != VS( cur, "__toUseVint" ) ||
+			 ( bool ) tab->chain[ i ] != ( SHOOKS( cur ) != NULL ) )
+			LOG( "\n (t=%g) Firm2 %g: vintage table mismatch (row=%d)",
+				 T, VS( firm, "_ID2" ), i );
+		++i;
+
+		n = VS( cur, "__nVint" );
+		A = VS( cur, "__Avint" );
+		nTot += n;
+		nA += n * A;
+		nP += n * VS( cur, "__pVint" );
+		nIA += n / A;
+		nAEA += n * A * VS( cur, "__EAvint" );
+	}
+
+	if ( abs( tot->n - nTot ) > TOL_VINT_TOT * max( nTot, 1.0 ) ||
+		 abs( tot->nA - nA ) > TOL_VINT_TOT * max( nA, 1.0 ) ||
+		 abs( tot->nP - nP ) > TOL_VINT_TOT * max( nP, 1.0 ) ||
+		 abs( tot->nIA - nIA ) > TOL_VINT_TOT * max( nIA, 1.0 ) ||
+		 abs( tot->nAEA - nAEA ) > TOL_VINT_TOT * max( nAEA, 1.0 ) )
+		LOG( "\n (t=%g) Firm2 %g: capital totals mismatch (n=%g, scan=%g)",
+			 T, VS( firm, "_ID2" ), tot->n, nTot );
+
+	if ( i != ( int ) tab->vint.size( ) )
+		LOG( "\n (t=%g) Firm2 %g: vintage table size mismatch (%d, scan=%d)",
+			 T, VS( firm, "_ID2" ), ( int ) tab->vint.size( ), i );
+}
+
+#endif
+
+
+// get the capital stock summary of a consumption-good firm, taken from the
+// running totals kept by 'vint_tot_add', in equations '_c2', '_K', '_Knom',
+// '_Q2p'
+
+vintSumT *vint_summary( object *firm )
+{
+	firm2E *ext = P_EXTS( firm, firm2E );
+	vintTotT *tot = & ext->tot;
+	vintSumT *sum = & ext->sum;
+
+	if ( sum->t == T )							// already computed?
+		return sum;
+
+#ifdef CHECK_VINT_TOT
+	vint_tot_check( firm );
+#endif
+
+	sum->n = tot->n;
+	sum->nA = tot->nA;
+	sum->nIA = tot->nIA;
+	sum->nP = tot->nP;
+	sum->EA = tot->nA > 0 ? tot->nAEA / tot->nA : 0;
+	sum->old = SEARCHS( firm, "Vint" );			// vintages kept in time order
+	sum->t = T;
+
+	return sum;
+}
+
+
+// get the scrapping part of the summary of a consumption-good firm, machines
+// to scrap up to the first vintage not to scrap (from the oldest) and in all
+// vintages, in equations '_SId', '_RS2'
+
+vintSumT *vint_summary_RS( object *firm )
+{
+	int i;
+	double RS;
+	vintSumT *sum = vint_summary( firm );
+
+	if ( sum->tRS == T )						// already computed?
+		return sum;
+
+	vintTabT *tab = vint_table( firm );
+	bool pre = true;
+
+	sum->RSpre = sum->RSall = 0;
+
+	for ( i = 0; i < ( int ) tab->vint.size( ); ++i )
+	{
+		RS = abs( VS( tab->vint[ i ], "__RSvint" ) );
+
+		if ( RS == 0 )
+			pre = false;
+
+		sum->RSall += RS;
+		if ( pre )
+			sum->RSpre += RS;
+	}
+
+	sum->tRS = T;
+
+	return sum;
+}
+
+
+// get the output part of the summary of a consumption-good firm, as computed
+// in equation '_alloc2', in equations '_Q2e', '_emissions_c'
+// if vintages changed after allocation, output is recomputed from the table
+
+vintSumT *vint_summary_out( object *firm )
+{
+	firm2E *ext = P_EXTS( firm, firm2E );
+	vintSumT *sum = & ext->sum;
+
+	if ( sum->tOut == T )						// already computed?
+		return sum;
+
+	vintTabT *tab = vint_table( firm );
+
+	sum->Q = kern_dot( tab->A.data( ), tab->L.data( ), 0, tab->vint.size( ) );
+	sum->E = kern_dot3( tab->A.data( ), tab->L.data( ), tab->EA.data( ),
+						0, tab->vint.size( ) );
+	sum->tOut = T;
+
+	return sum;
+}
+
+
+/*=================== FIRM SNAPSHOT SUPPORT C FUNCTIONS ======================*/
+
+// get the consumption-good market snapshot of a country, built once per
+// period from the firm demand shares, prices and available supply (output plus
+// inventories), in equation 'D2'
+
+firm2SnapT *firm2_snapshot( object *cntry )
+{
+	int j, k;
+	object *cur;
+	firm2SnapT *snap = & V_EXTS( cntry, countryE, firm2snap );
+
+	if ( snap->t == T )							// already built?
+		return snap;
+
+	snap->firm.clear( );						// keep allocated capacity
+	CYCLES( V_EXTS( cntry, countryE, conSec ), cur, "Firm2" )
+		snap->firm.push_back( cur );
+
+	k = snap->firm.size( );
+	snap->f2.resize( k );
+	snap->p2.resize( k );
+	snap->sup2.resize( k );
+	snap->d2.assign( k, 0 );
+	snap->l2.assign( k, 0 );
+
+	for ( j = 0; j < k; ++j )
+	{
+		cur = snap->firm[ j ];
+		snap->sup2[ j ] = VS( cur, "_Q2e" ) + VLS( cur, "_N", 1 );
+		snap->f2[ j ] = VS( cur, "_f2d" );
+		snap->p2[ j ] = VS( cur, "_p2" );
+	}
+
+	snap->t = T;
+
+	return snap;
+}
+
+
+// fused reductions over consumption-good firms: for each phase, the gate
+// variable (sector-level if no leading '_'), computed first, and the firm
+// variables added up in a single pass, which must be computed by the gate or
+// be side-effect-free functions of it; only variables whose equations depend
+// on the gate (trig) start the pass, the other ones use it only if done
+
+struct sum2VarT
+{
+	const char *var;							// firm variable to add up
+	int ph;										// reduction phase
+	bool trig;									// can start the phase pass
+};
+
+const char *sum2gate[ SUM2PH ] = { "_K", "D2", "_L2d", "_Tax2" };
+
+const sum2VarT sum2var[ ] = {
+	{ "_K", 0, true }, { "_Knom", 0, true }, { "_Inom", 0, true },
+	{ "_CI", 0, false }, { "_SI", 0, false }, { "_EI", 0, false },
+	{ "_Kd", 0, false }, { "_Q2", 0, false }, { "_Q2d", 0, false },
+	{ "_N", 1, true }, { "_S2", 1, true }, { "_dNnom", 1, true },
+	{ "_Q2e", 1, false }, { "_emissions_c", 1, false },
+	{ "_L2d", 2, true }, { "_JO2", 2, true },
+	{ "_Tax2", 3, true }, { "_Div2", 3, true }, { "_Pi2", 3, false },
+	{ "_W2", 3, false }, { "_i2", 3, false }, { "_iD2", 3, false }
+};
+
+
+// add up a firm variable over the consumption-good firms of sector, computing
+// all the variables in the same reduction phase in one pass, once per period
+
+double sum2( object *sector, const char *var )
+{
+	int i, j, n = sizeof( sum2var ) / sizeof( sum2var[ 0 ] );
+	object *cur;
+
+	for ( i = 0; i < n && strcmp( sum2var[ i ].var, var ) != 0; ++i );
+
+	if ( i == n )								// not in a reduction phase?
+		return SUMS( sector, var );
+
+	const sum2VarT &def = sum2var[ i ];
+	sum2PhT *ph = & V_EXTS( PARENTS( sector ), countryE, sum2ph[ def.ph ] );
+
+	if ( ph->t != T )							// phase not done in period?
+	{
+		if ( ! def.trig )						// can't compute gate now
+			return SUMS( sector, var );
+
+		const char *gate = sum2gate[ def.ph ];
+		bool secGate = gate[ 0 ] != '_';
+
+		if ( secGate )
+			VS( sector, gate );					// sector-level gate
+
+		ph->sum.assign( n, 0 );
+
+		CYCLES( sector, cur, "Firm2" )
+		{
+			if ( ! secGate )
+				VS( cur, gate );				// firm-level gate
+
+			for ( j = 0; j < n; ++j )
+				if ( sum2var[ j ].ph == def.ph )
+					ph->sum[ j ] += VS( cur, sum2var[ j ].var );
+		}
+
+		ph->t = T;
+	}
+
+	return ph->sum[ i ];
+}
+
+
+// weighted-average bundles over the firms of a sector: for each bundle, the
+// firm object, the sector gate variable (if any), computed first, and the
+// (value, weight) pairs added up in a single pass, which must be all final
+// when any of them is requested (the first pair weight sum is also kept)
+
+struct wavgDefT
+{
+	const char *val, *wgt;						// value and weight variables
+	int bdl;									// bundle
+};
+
+const char *wavgObj[ WAVGBDL ] = { "Firm1", "Firm2", "Firm2", "Firm2",
+								   "Firm2", "Firm2" };
+const char *wavgGate[ WAVGBDL ] = { "f1rescale", "f2rescale", NULL, NULL,
+									NULL, NULL };
+
+const wavgDefT wavgDef[ ] = {
+	{ "_p1", "_f1", 0 }, { "_Btau", "_f1", 0 }, { "_EAtau", "_f1", 0 },
+	{ "_f1", "_f1", 0 },
+	{ "_p2", "_f2", 1 }, { "_A2", "_f2", 1 }, { "_mu2", "_f2", 1 },
+	{ "_f2", "_f2", 1 },
+	{ "_p2", "_life2cycle", 2 },
+	{ "_l2", "_life2cycle", 3 },
+	{ "_c2", "_Q2", 4 },
+	{ "_c2e", "_Q2e", 5 }
+};
+
+
+// sum of value times weight over the firms in sector, computing all the pairs
+// in the same bundle in one pass, once per period, optionally also returning
+// the sum of weights
+
+double wavg( object *sector, const char *val, const char *wgt,
+			 double *wSum = NULL )
+{
+	int i, j, n = sizeof( wavgDef ) / sizeof( wavgDef[ 0 ] );
+	object *cur;
+
+	for ( i = 0; i < n && ( strcmp( wavgDef[ i ].val, val ) != 0 ||
+							strcmp( wavgDef[ i ].wgt, wgt ) != 0 ); ++i );
+
+	if ( i == n )								// not in a bundle?
+	{
+		if ( wSum != NULL )
+			*wSum = SUMS( sector, wgt );
+
+		return WHTAVES( sector, val, wgt );
+	}
+
+	int b = wavgDef[ i ].bdl;
+	wavgBdlT *bdl = & V_EXTS( PARENTS( sector ), countryE, wavg[ b ] );
+
+	if ( bdl->t != T )							// bundle not done in period?
+	{
+		if ( wavgGate[ b ] != NULL )
+			VS( sector, wavgGate[ b ] );		// ensure values are final
+
+		bdl->vw.assign( n, 0 );
+		bdl->w = 0;
+
+		CYCLES( sector, cur, wavgObj[ b ] )
+		{
+			bool first = true;
+
+			for ( j = 0; j < n; ++j )
+				if ( wavgDef[ j ].bdl == b )
+				{
+					double w = VS( cur, wavgDef[ j ].wgt );
+					bdl->vw[ j ] += VS( cur, wavgDef[ j ].val ) * w;
+
+					if ( first )
+					{
+						bdl->w += w;
+						first = false;
+					}
+				}
+		}
+
+		bdl->t = T;
+	}
+
+	if ( wSum != NULL )
+		*wSum = bdl->w;
+
+	return bdl->vw[ i ];
+}
+
+
+// invalidate the weighted-average bundles of a country over a firm object,
+// when firm objects are created or destroyed
+
+void wavg_stale( object *cntry, const char *firm )
+{
+	for ( int b = 0; b < WAVGBDL; ++b )
+		if ( strcmp( wavgObj[ b ], firm ) == 0 )
+			V_EXTS( cntry, countryE, wavg[ b ] ).t = -1;
+}
+
+
+// invalidate the per-period supplier offers and weighted averages of a
+// country, when firm objects in sector 1 are created or destroyed
+
+void firm1_stale( object *cntry )
+{
+	V_EXTS( cntry, countryE, offer1 ).t = -1;
+	wavg_stale( cntry, "Firm1" );
+}
+
+
+// invalidate the per-period firm snapshot and fused reductions of a country,
+// when firm objects in sector 2 are created or destroyed
+
+void firm2_stale( object *cntry )
+{
+	V_EXTS( cntry, countryE, firm2snap ).t = -1;
+
+	for ( int i = 0; i < SUM2PH; ++i )
+		V_EXTS( cntry, countryE, sum2ph[ i ] ).t = -1;
+
+	wavg_stale( cntry, "Firm2" );
+}
+
+
+/*================ SUPPLIER-CLIENT GRAPH SUPPORT C FUNCTIONS ==================*/
+
+// first edge in adjacency list of firm ID (-1 if none)
+
+int edge_first( const vector < int > &head, int ID )
+{
+	return ID >= 0 && ID < ( int ) head.size( ) ? head[ ID ] : -1;
+}
+
+
+// number of edges in adjacency list of firm ID
+
+int edge_deg( const vector < int > &deg, int ID )
+{
+	return ID >= 0 && ID < ( int ) deg.size( ) ? deg[ ID ] : 0;
+}
+
+
+// ensure adjacency lists have a node for firm ID (amortized growth)
+
+void edge_node( vector < int > &head, vector < int > &tail, vector < int > &deg,
+				int ID )
+{
+	if ( ID < ( int ) head.size( ) )
+		return;
+
+	int n = max( ID + 1, 2 * ( int ) head.size( ) );
+	head.resize( n, -1 );
+	tail.resize( n, -1 );
+	deg.resize( n, 0 );
+}
+
+
+// remove edge from its expiry bucket
+
+void edge_bkt_out( edgeStoreT *g, int i )
+{
+	edgeT &e = g->e[ i ];
+
+	if ( e.prevB >= 0 )
+		g->e[ e.prevB ].nextB = e.nextB;
+	else
+		g->headB[ e.tSel % EXPBKT ] = e.nextB;
+	if ( e.nextB >= 0 )
+		g->e[ e.nextB ].prevB = e.prevB;
+
+	e.prevB = e.nextB = -1;
+}
+
+
+void edge_del( edgeStoreT *g, int i );
+
+// put edge in the expiry bucket of its selection time, expiring the ring
+// slot first if still holding an older (overdue) bucket
+
+void edge_bkt_in( edgeStoreT *g, int i )
+{
+	int b = g->e[ i ].tSel % EXPBKT;
+
+	if ( g->tB[ b ] != g->e[ i ].tSel )			// slot holds older bucket?
+	{
+		while ( g->headB[ b ] >= 0 )			// remove overdue edges
+			edge_del( g, g->headB[ b ] );
+
+		g->tB[ b ] = g->e[ i ].tSel;
+	}
+
+	g->e[ i ].prevB = -1;						// push front
+	g->e[ i ].nextB = g->headB[ b ];
+	if ( g->headB[ b ] >= 0 )
+		g->e[ g->headB[ b ] ].prevB = i;
+	g->headB[ b ] = i;
+}
+
+
+// add supplier-client edge at the end of both firm adjacency lists,
+// reusing a free edge slot, if any
+// return the edge index
+
+int edge_add( edgeStoreT *g, object *sup, object *cli )
+{
+	int i;
+	edgeT edge;
+
+	edge.sup = sup;
+	edge.cli = cli;
+	edge.IDs = VS( sup, "_ID1" );
+	edge.IDc = VS( cli, "_ID2" );
+	edge.tSel = T;								// selection time
+
+	edge_node( g->headS, g->tailS, g->degS, edge.IDs );
+	edge_node( g->headC, g->tailC, g->degC, edge.IDc );
+	if ( g->book.size( ) < g->headS.size( ) )
+		g->book.resize( g->headS.size( ) );
+
+	if ( g->freeE.empty( ) )
+	{
+		i = g->e.size( );
+		g->e.push_back( edge );
+	}
+	else
+	{
+		i = g->freeE.back( );
+		g->freeE.pop_back( );
+		g->e[ i ] = edge;
+	}
+
+	edgeT &e = g->e[ i ];
+
+	e.prevS = g->tailS[ e.IDs ];				// append to supplier list
+	if ( e.prevS >= 0 )
+		g->e[ e.prevS ].nextS = i;
+	else
+		g->headS[ e.IDs ] = i;
+	g->tailS[ e.IDs ] = i;
+	++g->degS[ e.IDs ];
+
+	e.prevC = g->tailC[ e.IDc ];				// append to client list
+	if ( e.prevC >= 0 )
+		g->e[ e.prevC ].nextC = i;
+	else
+		g->headC[ e.IDc ] = i;
+	g->tailC[ e.IDc ] = i;
+	++g->degC[ e.IDc ];
+
+	edge_bkt_in( g, i );						// expiry by selection time
+
+	return i;
+}
+
+
+// get the current period order book of supplier firm ID, resetting it if
+// from a previous period (NULL if supplier has no edge)
+
+orderBookT *order_book( edgeStoreT *g, int ID )
+{
+	if ( ID < 0 || ID >= ( int ) g->book.size( ) )
+		return NULL;
 
-// send machine brochure to consumption-good client firm in equations '_NC',
-// '_supplier'
+	orderBookT *book = & g->book[ ID ];
+
+	if ( book->t < T )							// orders from old period?
+	{
+		book->ord.clear( );						// keep allocated capacity
+		book->nOrd = book->nCan = 0;
+		book->t = T;
+	}
+
+	return book;
+}
+
+
+// cancel a fraction of all orders in the period order book of supplier firm
+// ID, rounding down the machines canceled per order and, if required,
+// keeping at least one machine in each order
+// return the total number of machines canceled
+
+double order_cancel( edgeStoreT *g, int ID, double frac, bool keepOne )
+{
+	double nCan, canTot = 0;
+	orderBookT *book = order_book( g, ID );
+
+	if ( book == NULL )
+		return 0;
+
+	for ( int i : book->ord )
+	{
+		edgeT &e = g->e[ i ];
+
+		if ( keepOne )							// net orders, supply at least 1
+		{
+			nCan = e.nOrd - e.nCan;
+			nCan = min( floor( nCan * frac ), nCan - 1 );
+		}
+		else
+			nCan = floor( e.nOrd * frac );
+
+		e.nCan += nCan;
+		canTot += nCan;
+	}
+
+	book->nCan += canTot;
+
+	return canTot;
+}
+
+
+// remove supplier-client edge from both firm adjacency lists, the supplier
+// order book and the client current supplier, if so
+
+void edge_del( edgeStoreT *g, int i )
+{
+	edgeT &e = g->e[ i ];
+
+	if ( e.sup == NULL )						// already free?
+		return;
+
+	if ( e.prevS >= 0 )							// unlink from supplier list
+		g->e[ e.prevS ].nextS = e.nextS;
+	else
+		g->headS[ e.IDs ] = e.nextS;
+	if ( e.nextS >= 0 )
+		g->e[ e.nextS ].prevS = e.prevS;
+	else
+		g->tailS[ e.IDs ] = e.prevS;
+	--g->degS[ e.IDs ];
+
+	if ( e.prevC >= 0 )							// unlink from client list
+		g->e[ e.prevC ].nextC = e.nextC;
+	else
+		g->headC[ e.IDc ] = e.nextC;
+	if ( e.nextC >= 0 )
+		g->e[ e.nextC ].prevC = e.prevC;
+	else
+		g->tailC[ e.IDc ] = e.prevC;
+	--g->degC[ e.IDc ];
+
+	edge_bkt_out( g, i );
+
+	if ( e.tOrd == T )							// leave supplier order book
+	{
+		orderBookT *book = order_book( g, e.IDs );
+		auto it = find( book->ord.begin( ), book->ord.end( ), i );
+
+		if ( it != book->ord.end( ) )
+		{
+			*it = book->ord.back( );
+			book->ord.pop_back( );
+			book->nOrd -= e.nOrd;
+			book->nCan -= e.nCan;
+		}
+	}
+
+	firm2E *ext = P_EXTS( e.cli, firm2E );
+	if ( ext != NULL && ext->supEdge == i )		// current supplier?
+		ext->supEdge = -1;
+
+	e = edgeT( );								// free slot
+	g->freeE.push_back( i );
+}
+
+
+// update edge selection time to current period, moving it to the new
+// expiry bucket, in equation '_supplier'
+
+void edge_touch( edgeStoreT *g, int i )
+{
+	if ( g->e[ i ].tSel == T )					// already current?
+		return;
+
+	edge_bkt_out( g, i );
+	g->e[ i ].tSel = T;
+	edge_bkt_in( g, i );
+}
+
+
+// remove edges not selected in the current or previous periods, once per
+// period, popping only the due expiry buckets, in equation '_HC'
+
+void edge_expire( edgeStoreT *g )
+{
+	if ( g->tExp == T )							// already done?
+		return;
+
+	for ( int b = 0; b < EXPBKT; ++b )
+		if ( g->tB[ b ] < T - 1 )				// last selection is old?
+			while ( g->headB[ b ] >= 0 )
+				edge_del( g, g->headB[ b ] );
+
+	g->tExp = T;
+}
+
+
+// remove all edges of a supplier (or client) firm, in function 'exit_firms'
+
+void edge_del_firm( edgeStoreT *g, object *firm, bool supplier )
+{
+	int i, next;
+
+	if ( supplier )
+		for ( i = edge_first( g->headS, VS( firm, "_ID1" ) ); i >= 0; i = next )
+		{
+			next = g->e[ i ].nextS;
+			edge_del( g, i );
+		}
+	else
+		for ( i = edge_first( g->headC, VS( firm, "_ID2" ) ); i >= 0; i = next )
+		{
+			next = g->e[ i ].nextC;
+			edge_del( g, i );
+		}
+}
+
+
+// current machine supplier edge of firm in consumption-good sector
+
+edgeT *sup_edge( object *firm )
+{
+	int i = P_EXTS( firm, firm2E )->supEdge;
+
+	return i >= 0 ? & V_EXTS( GRANDPARENTS( firm ), countryE, edges ).e[ i ]
+				  : NULL;
+}
+
+
+// current machine supplier of firm in consumption-good sector
 
-object *send_brochure( object *suppl, object *client )
+object *supplier2( object *firm )
 {
-	object *broch, *cli;
+	edgeT *e = sup_edge( firm );
+
+	return e != NULL ? e->sup : NULL;
+}
+
+
+// get the machine offers of capital-good firms of a country, indexed by
+// supplier ID, built once per period after innovation is done: price, unit
+// operating cost and total machine unit cost over the payback period, in
+// equation '_supplier'
+
+offerTabT *offer_table( object *cntry )
+{
+	int k;
+	double m2, b;
+	object *cur, *cap = V_EXTS( cntry, countryE, capSec ),
+		   *con = V_EXTS( cntry, countryE, conSec );
+	offerTabT *off = & V_EXTS( cntry, countryE, offer1 );
+
+	VS( cap, "inn" );							// ensure innovation is done and
+												// brochures distributed
+	if ( off->t == T )							// already built?
+		return off;
+
+	m2 = VS( con, "m2" );						// machine modularity
+	b = VS( con, "b" );							// required payback period
+
+	k = 0;
+	CYCLES( cap, cur, "Firm1" )					// find largest supplier ID
+		k = max( k, ( int ) VS( cur, "_ID1" ) + 1 );
+
+	off->p1.assign( k, 0 );						// keep allocated capacity
+	off->cTau.assign( k, 0 );
+	off->cost.assign( k, DBL_MAX );				// no offer from gaps
+
+	CYCLES( cap, cur, "Firm1" )
+	{
+		k = VS( cur, "_ID1" );
+		off->p1[ k ] = VS( cur, "_p1" );
+		off->cTau[ k ] = VS( cur, "_cTau" );
+
+		// total machine unit cost (acquisition + operation for payback period)
+		off->cost[ k ] = off->p1[ k ] / m2 + off->cTau[ k ] * b;
+	}
+
+	off->t = T;
+
+	return off;
+}
+
 
-	cli = ADDOBJS( suppl, "Cli" );				// add object to new client
-	WRITES( cli, "__IDc", VS( client, "_ID2" ) );// update client ID
-	WRITES( cli, "__tSel", T );					// update selection time
+/*================== CAPITAL MANAGEMENT SUPPORT C FUNCTIONS ==================*/
 
-	broch = ADDOBJS( client, "Broch" );			// add brochure to client
-	WRITES( broch, "__IDs", VS( suppl, "_ID1" ) );// update supplier ID
-	WRITE_SHOOKS( broch, cli );					// pointer to supplier client list
-	WRITE_SHOOKS( cli, broch );					// pointer to client brochure list
+// send machine brochure to consumption-good client firm in equations '_NC',
+// '_supplier'
+// return the new supplier-client edge
 
-	return broch;
+int send_brochure( object *suppl, object *client )
+{
+	return edge_add( & V_EXTS( GRANDPARENTS( suppl ), countryE, edges ),
+					 suppl, client );
 }
 
 
@@ -198,12 +1347,11 @@ object *send_brochure( object *suppl, object *client )
 
 object *set_supplier( object *firm )
 {
-	object *broch, *suppl,
-		   *cap = V_EXTS( GRANDPARENTS( firm ), countryE, capSec );
+	object *suppl, *cap = V_EXTS( GRANDPARENTS( firm ), countryE, capSec );
 
 	suppl = RNDDRAWS( cap, "Firm1", "_Atau" );	// draw capital supplier
-	broch = send_brochure( suppl, firm );		// get supplier brochure
-	WRITE_HOOKS( firm, SUPPL, broch );			// pointer to current supplier
+	P_EXTS( firm, firm2E )->supEdge = send_brochure( suppl, firm );
+												// get supplier brochure
 	INCRS( suppl, "_NC", 1 );					// update supplier's clients #
 
 	return suppl;
@@ -214,17 +1362,22 @@ object *set_supplier( object *firm )
 
 void send_order( object *firm, double nMach )
 {
-	// find firm entry on supplier client list
-	object *cli = SHOOKS( HOOKS( firm, SUPPL ) );
+	edgeStoreT *g = & V_EXTS( GRANDPARENTS( firm ), countryE, edges );
+	int i = P_EXTS( firm, firm2E )->supEdge;	// firm edge with supplier
+	edgeT *cli = & g->e[ i ];
+	orderBookT *book = order_book( g, cli->IDs );// supplier order book
 
-	if ( VS( cli, "__tOrd" ) < T )				// if first order in period
+	if ( cli->tOrd < T )						// if first order in period
 	{
-		WRITES( cli, "__nOrd", nMach );			// set new order size
-		WRITES( cli, "__tOrd", T );				// set order time
-		WRITES( cli, "__nCan", 0 );				// no machine canceled yet
+		cli->nOrd = nMach;						// set new order size
+		cli->tOrd = T;							// set order time
+		cli->nCan = 0;							// no machine canceled yet
+		book->ord.push_back( i );				// add order to book
 	}
 	else
-		INCRS( cli, "__nOrd", nMach );			// increase existing order size
+		cli->nOrd += nMach;						// increase existing order size
+
+	book->nOrd += nMach;
 }
 
 
@@ -240,7 +1393,7 @@ double invest( object *firm, double desired )
 	double m2 = VS( PARENTS( firm ), "m2" );	// machine output per period
 	double _CS2a = VS( firm, "_CS2a" );			// available credit supply
 	double _NW2 = VS( firm, "_NW2" );			// net worth (cash available)
-	double _p1 = VS( PARENTS( SHOOKS( HOOKS( firm, SUPPL ) ) ), "_p1" );
+	double _p1 = VS( supplier2( firm ), "_p1" );
 
 	invCost = _p1 * desired / m2;				// desired investment cost
 
@@ -294,6 +1447,43 @@ double invest( object *firm, double desired )
 }
 
 
+// add/remove a live vintage to/from the country vintage registry in
+// functions 'add_vintage', 'vint_del', 'exit_firms'
+
+void vint_reg_add( object *vint )
+{
+	object *cntry = PARENTS( GRANDPARENTS( vint ) );
+
+	V_EXTS( cntry, countryE, vint2reg )[ VS( vint, "__IDvint" ) ].insert( vint );
+}
+
+
+void vint_reg_del( object *vint )
+{
+	object *cntry = PARENTS( GRANDPARENTS( vint ) );
+	vintRegT *reg = & V_EXTS( cntry, countryE, vint2reg );
+	auto itr = reg->find( VS( vint, "__IDvint" ) );
+
+	if ( itr == reg->end( ) )					// not registered?
+		return;
+
+	itr->second.erase( vint );
+
+	if ( itr->second.empty( ) )					// no more vintage with key?
+		reg->erase( itr );
+}
+
+
+// delete a scrapped or merged vintage object in functions 'scrap_vintages',
+// 'merge_vintage'
+
+void vint_del( variable *var, object *vint )
+{
+	vint_reg_del( vint );						// remove from live vintages
+	DELETE( vint );								// delete vintage
+}
+
+
 // add new vintage to the capital stock of a firm in equation 'K' and 'initCountry'
 
 void add_vintage( object *firm, double nMach, bool newInd )
@@ -301,8 +1491,9 @@ void add_vintage( object *firm, double nMach, bool newInd )
 	double __Avint, __pVint;
 	int __ageVint, __nMach, __nVint;
 	object *cap, *cons, *cur, *suppl, *vint;
+	vintTabT *tab = vint_table( firm );
 
-	suppl = PARENTS( SHOOKS( HOOKS( firm, SUPPL ) ) );// current supplier
+	suppl = supplier2( firm );					// current supplier
 	__nMach = floor( nMach );					// integer number of machines
 
 	// at t=1 firms have a mix of machines: old to new, many suppliers
@@ -322,6 +1513,10 @@ void add_vintage( object *firm, double nMach, bool newInd )
 		__nVint = __nMach;
 		__Avint = VS( suppl, "_Atau" );
 		__pVint = VS( suppl, "_p1" );
+
+		firm2E *ext = P_EXTS( firm, firm2E );	// save investment in period
+		ext->Inom = __nVint * __pVint;			// (vintage may be merged)
+		ext->tInom = T;
 	}
 
 	while ( __nMach > 0 )
@@ -349,47 +1544,332 @@ void add_vintage( object *firm, double nMach, bool newInd )
 		WRITES( vint, "__pVint", __pVint );		// price of machines in vintage
 		WRITES( vint, "__tVint", 1 - __ageVint );// vintage build time
 
+		vint_reg_add( vint );					// add to live vintages
+
+		vint_row_add( tab, vint, __nVint, __Avint, __pVint, 1 - __ageVint,
+					  SHOOKS( vint ) != NULL );	// add vintage table row
+		vint_tot_add( firm, tab->vint.size( ) - 1, 1 );// update capital totals
+
 		__nMach -= __nVint;
 		--__ageVint;
 
 		if ( __ageVint > 0 && __nMach % __ageVint == 0 )// exact ratio missing?
 			__nVint = __nMach / __ageVint;		// adjust machines per vintage
 	}
+
+	vint_stale( firm );							// update vintage summary
 }
 
 
-// scrap (remove) vintage from capital stock in equation 'K'
-// return -1 if last vintage (not removed but shrank to 1 machine)
+// get the vintage scrapping plan of a consumption-good firm, computed once
+// per period, in equation '__RSvint'
+// the productivity cutoff is only computed when a vintage in technical life
+// is evaluated (see 'scrap_plan_cut'), so the supplier is not required if
+// all vintages are out of technical life
 
-double scrap_vintage( variable *var, object *vint )
+scrapPlanT *scrap_plan( object *firm )
 {
-	double RS;
+	scrapPlanT *plan = & P_EXTS( firm, firm2E )->scrap;
+
+	if ( plan->t == T )							// already computed?
+		return plan;
 
-	if ( NEXTS( vint ) != NULL )				// don't remove last vintage
+	plan->tMin = T - VS( PARENTS( firm ), "eta" );
+	plan->t = T;
+
+	return plan;
+}
+
+
+// compute the productivity cutoff of the scrapping plan of a consumption-good
+// firm, once per period, in function 'scrap_plan_RS'
+// new machines replace old ones if the unit cost gain pays the new machine
+// price in less than b periods: w / A - w / Anew >= p1 / ( m2 * b ), so any
+// vintage with productivity A <= w / ( w / Anew + p1 / ( m2 * b ) ) is replaced
+
+void scrap_plan_cut( object *firm, scrapPlanT *plan )
+{
+	double Anew, c, p1, w;
+	object *cons = PARENTS( firm ), *suppl;
+
+	VS( firm, "_supplier" );					// ensure supplier is selected
+	suppl = supplier2( firm );					// pointer to supplier
+
+	w = VS( V_EXTS( PARENTS( cons ), countryE, labSup ), "w" );// firm wage
+	Anew = VS( suppl, "_Atau" );				// new machines productivity
+	p1 = VS( suppl, "_p1" );					// new machines price
+
+	// minimum unit cost gain to pay back new machines
+	c = p1 > 0 ? p1 / VS( cons, "m2" ) / VS( cons, "b" ) : 0;
+
+	plan->Acut = w / ( w / Anew + c );
+	plan->strict = ( c == 0 );					// free machines: gain required
+	plan->tCut = T;
+}
+
+
+// number of machines to scrap in a vintage of a consumption-good firm
+// according to the scrapping plan in equation '__RSvint'
+
+double scrap_plan_RS( object *firm, scrapPlanT *plan, double n, double A,
+					  double tV )
+{
+	if ( tV < plan->tMin )						// out of technical life?
+		return - n;
+
+	if ( plan->tCut != T )						// cutoff not yet computed?
+		scrap_plan_cut( firm, plan );
+
+	if ( plan->strict ? A < plan->Acut : A <= plan->Acut )
+		return n;								// can be replaced
+
+	return 0;
+}
+
+
+// apply the scrapping plan of a consumption-good firm in equation '_K'
+// vintages are shrunk to the planned size or, if zero, deleted, compacting
+// the vintage table and unlinking the deleted vintages as previous vintage
+// from the remaining ones in a single pass
+
+void scrap_vintages( variable *var, object *firm, vintActVecT *acts )
+{
+	int i, j;
+	vintTabT *tab = vint_table( firm );
+	vector < char > gone( tab->vint.size( ), false );// rows to remove
+
+	for ( auto itr = acts->begin( ); itr != acts->end( ); ++itr )
+		if ( itr->n > 0 )
+			vint_resize( firm, itr->i, itr->n );// shrink vintage
+		else
+		{
+			vint_tot_add( firm, itr->i, -1 );	// update capital stock totals
+			gone[ itr->i ] = true;
+		}
+
+	// drop removed rows, keeping the others in build time order
+	for ( i = j = 0; i < ( int ) tab->vint.size( ); ++i )
+		if ( gone[ i ] )
+			vint_del( var, tab->vint[ i ] );	// delete vintage
+		else
+		{
+			if ( i > 0 && gone[ i - 1 ] && tab->chain[ i ] )
+			{									// remove as previous vintage
+				WRITE_SHOOKS( tab->vint[ i ], NULL );
+				tab->chain[ i ] = false;
+			}
+
+			vint_row_copy( tab, i, j++ );
+		}
+
+	if ( j < ( int ) tab->vint.size( ) )
+	{
+		vint_rows_keep( tab, j );
+		vint_rows_Ld( firm, tab, 0 );
+	}
+
+	vint_stale( firm );							// update vintage summary
+}
+
+
+// check if a vintage can be merged into the previous one: same build period,
+// supplier and emissions and productivities within tolerance, in function
+// 'merge_vintage' and equation 'test2'
+
+bool vint_mergeable( object *prev, object *top, double tol )
+{
+	if ( prev == NULL || top == NULL )
+		return false;
+
+	double A0 = VS( prev, "__Avint" );
+
+	return VS( prev, "__tVint" ) == VS( top, "__tVint" ) &&
+		   SUP( VS( prev, "__IDvint" ) ) == SUP( VS( top, "__IDvint" ) ) &&
+		   VS( prev, "__EAvint" ) == VS( top, "__EAvint" ) &&
+		   abs( VS( top, "__Avint" ) - A0 ) <= tol * A0;
+}
+
+
+// merge the top (newest) vintage of a consumption-good firm into the
+// previous ones while they are mergeable (see 'vint_mergeable'), in
+// equation '_K'
+// the merged vintage keeps the build period (so '__RSvint' is unchanged),
+// the total unit cost (harmonic mean productivity) and the nominal value
+// (machine-weighted mean price)
+// return the number of vintages merged
+
+int merge_vintage( variable *var, object *firm )
+{
+	int i, merged = 0;
+	double A0, A1, n0, n1, p0, p1,
+		   tol = VS( PARENTS( firm ), "tolA2" );
+	vintTabT *tab = vint_table( firm );
+	int k = tab->vint.size( );
+
+	// top vintage is the last table row, previous one is chained before it
+	while ( k > 1 && tab->chain[ k - 1 ] &&
+			vint_mergeable( tab->vint[ k - 2 ], tab->vint[ k - 1 ], tol ) )
 	{
-		// remove as previous vintage from next vintage
-		if ( SHOOKS( NEXTS( vint ) ) == vint )
-			WRITE_SHOOKS( NEXTS( vint ), NULL );
+		i = k - 2;								// previous vintage row
+		A0 = tab->A[ i ];
+		A1 = tab->A[ k - 1 ];
+		n0 = tab->n[ i ];
+		n1 = tab->n[ k - 1 ];
+		p0 = tab->p[ i ];
+		p1 = tab->p[ k - 1 ];
+
+		vint_tot_add( firm, i, -1 );			// update capital stock totals
+		vint_tot_add( firm, k - 1, -1 );
+
+		tab->A[ i ] = ( n0 + n1 ) / ( n0 / A0 + n1 / A1 );
+		tab->p[ i ] = ( n0 * p0 + n1 * p1 ) / ( n0 + n1 );
+		tab->n[ i ] = n0 + n1;
+
+		WRITES( tab->vint[ i ], "__Avint", tab->A[ i ] );// write back to LSD
+		WRITES( tab->vint[ i ], "__pVint", tab->p[ i ] );
+		WRITES( tab->vint[ i ], "__nVint", tab->n[ i ] );
 
-		RS = abs( VS( vint, "__RSvint" ) );
-		DELETE( vint );							// delete vintage
+		vint_tot_add( firm, i, 1 );
+
+		WRITE_HOOKS( firm, TOPVINT, tab->vint[ i ] );// previous is now top
+		vint_del( var, tab->vint[ k - 1 ] );
+
+		vint_rows_keep( tab, --k );
+		++merged;
 	}
-	else
+
+	if ( merged > 0 )
 	{
-		RS = -1;								// signal last machine
-		WRITES( vint, "__nVint", 1 );			// keep just 1 machine
+		vint_rows_Ld( firm, tab, k - 1 );
+		vint_stale( firm );						// update vintage summary
 	}
 
-	return RS;
+	return merged;
 }
 
 
 /*=================== FIRM ENTRY-EXIT SUPPORT C FUNCTIONS ====================*/
 
+// add live firm to ID-indexed registry, in function 'entry_firm2'
+
+void firm_reg_add( firmRegT *reg, int ID, object *firm )
+{
+	if ( ID >= ( int ) reg->slot.size( ) )		// grow registry (amortized)
+	{
+		reg->slot.resize( max( ID + 1, 2 * ( int ) reg->slot.size( ) ), NULL );
+		reg->live.resize( reg->slot.size( ), false );
+		reg->pos.resize( reg->slot.size( ), -1 );
+		reg->mark.resize( reg->slot.size( ), false );
+	}
+
+	if ( ! reg->live[ ID ] )
+	{
+		reg->pos[ ID ] = reg->ids.size( );
+		reg->ids.push_back( ID );
+		++reg->n;
+	}
+
+	reg->slot[ ID ] = firm;
+	reg->live[ ID ] = true;
+}
+
+
+// remove firm from ID-indexed registry, in function 'exit_firms'
+
+void firm_reg_del( firmRegT *reg, int ID )
+{
+	if ( ID < 0 || ID >= ( int ) reg->slot.size( ) || ! reg->live[ ID ] )
+		return;
+
+	int last = reg->ids.back( );				// move last ID to freed position
+	reg->ids[ reg->pos[ ID ] ] = last;
+	reg->pos[ last ] = reg->pos[ ID ];
+	reg->ids.pop_back( );
+
+	reg->slot[ ID ] = NULL;
+	reg->live[ ID ] = false;
+	reg->pos[ ID ] = -1;
+	--reg->n;
+}
+
+
+// get live firm by ID from registry (NULL if not live)
+
+object *firm_reg_get( firmRegT *reg, int ID )
+{
+	return ID >= 0 && ID < ( int ) reg->slot.size( ) && reg->live[ ID ] ?
+		   reg->slot[ ID ] : NULL;
+}
+
+
+// draw up to n distinct live firms from registry, excluding the given IDs,
+// by rejection sampling over the live list (cost in the order of n) or, if
+// few firms are eligible, by partial shuffle of the eligible ones
+// return the number of firms drawn (in drawn), in equation '_NC'
+
+int firm_reg_sample( firmRegT *reg, const vector < int > &excl, int n,
+					 objVecT &drawn )
+{
+	int i, j, avail = reg->n;
+	vector < int > got;							// drawn IDs
+
+	drawn.clear( );
+
+	for ( auto ID : excl )						// mark excluded live firms
+		if ( ID >= 0 && ID < ( int ) reg->mark.size( ) && reg->live[ ID ] &&
+			 ! reg->mark[ ID ] )
+		{
+			reg->mark[ ID ] = true;
+			--avail;
+		}
+
+	n = min( n, avail );
+
+	if ( n > 0 && 2 * ( reg->n - avail + n ) <= reg->n )// rejection ok?
+		while ( ( int ) got.size( ) < n )
+		{
+			j = reg->ids[ uniform_int( 0, reg->n - 1 ) ];
+
+			if ( ! reg->mark[ j ] )				// not excluded or drawn?
+			{
+				reg->mark[ j ] = true;
+				got.push_back( j );
+			}
+		}
+	else
+		if ( n > 0 )
+		{
+			vector < int > elig;				// eligible firms
+			for ( auto ID : reg->ids )
+				if ( ! reg->mark[ ID ] )
+					elig.push_back( ID );
+
+			for ( i = 0; i < n; ++i )			// partial Fisher-Yates shuffle
+			{
+				j = uniform_int( i, elig.size( ) - 1 );
+				swap( elig[ i ], elig[ j ] );
+				got.push_back( elig[ i ] );
+			}
+		}
+
+	for ( auto ID : excl )						// clear scratch bitset
+		if ( ID >= 0 && ID < ( int ) reg->mark.size( ) )
+			reg->mark[ ID ] = false;
+
+	for ( auto ID : got )
+	{
+		reg->mark[ ID ] = false;
+		drawn.push_back( reg->slot[ ID ] );
+	}
+
+	return drawn.size( );
+}
+
+
 // add and configure entrant capital-good firm object(s) and required hooks
 // in equations 'entry1exit' and 'initCountry'
 
-double entry_firm1( variable *var, object *sector, int n, bool newInd )
+double entry_firm1( object *sector, int n, bool newInd )
 {
 	double _Atau, _Btau, _D10, _Deb1, _Eq1, _L1rd, _NW1, _NW10, _RD0, _c1, _f1,
 		   _p1, AtauMax, BtauMax, Deb1, Eq1, NW1, mult;
@@ -453,8 +1933,6 @@ double entry_firm1( variable *var, object *sector, int n, bool newInd )
 		_ID1 = INCRS( sector, "lastID1", 1 );	// new firm ID
 		WRITES( firm, "_ID1", _ID1 );
 
-		DELETE( SEARCHS( firm, "Cli" ) );		// remove empty instances
-
 		if ( ! newInd )
 		{
 			// initial labor productivity (imitation from best firm)
@@ -599,10 +2077,12 @@ double entry_firm2( variable *var, object *sector, int n, bool newInd )
 
 		_ID2 = INCRS( sector, "lastID2", 1 );	// new firm ID
 		WRITES( firm, "_ID2", _ID2 );
+		firm_reg_add( & V_EXTS( PARENTS( sector ), countryE, firm2reg ), _ID2,
+					  firm );
 
+		ADDEXTS( firm, firm2E );				// add firm extension
 		ADDHOOKS( firm, FIRM2HK );				// add object hooks
 		DELETE( SEARCHS( firm, "Vint" ) );		// remove empty instances
-		DELETE( SEARCHS( firm, "Broch" ) );
 
 		// select initial machine supplier
 		suppl = set_supplier( firm );
@@ -689,47 +2169,75 @@ double entry_firm2( variable *var, object *sector, int n, bool newInd )
 }
 
 
-// remove firm object and existing hooks in equation 'entry1exit', 'entry2exit'
+// remove a batch of quitting firm objects of a sector and their existing hooks
+// in equations 'entry1exit', 'entry2exit', settling the liquidation accounting
+// with single sector/bank updates; firm indexes must be rebuilt afterwards
 
 const char *BadDebVar[ ] = { "BadDeb1", "BadDeb2" },
 		   *_EqVar[ ] = { "_Eq1", "_Eq2" },
 		   *EqVar[ ] = { "Eq1", "Eq2" },
-		   *cExitVar[ ] = { "cExit1", "cExit2" },
-		   *CliBrochObj[ ] = { "Cli", "Broch" };
+		   *cExitVar[ ] = { "cExit1", "cExit2" };
 
-double exit_firm( variable *var, object *firm )
+double exit_firms( variable *var, object *sector, objVecT &quit )
 {
-	double liqEq, liqVal;
-	object *cli, *fin = SEARCHS( GRANDPARENTS( firm ), "Financial" );
-	int sec = strcmp( NAMES( firm ), "Firm1" ) == 0 ? 0 : 1;
+	int i;
+	double liqVal, Eq = 0, badDeb = 0, liqEq = 0;
+	object *fin = SEARCHS( PARENTS( sector ), "Financial" );
+	edgeStoreT *g = & V_EXTS( PARENTS( sector ), countryE, edges );
+	firmRegT *reg = & V_EXTS( PARENTS( sector ), countryE, firm2reg );
 
-	// remove equity from sector total
-	INCRS( PARENTS( firm ), EqVar[ sec ], - VS( firm, _EqVar[ sec ] ) );
+	if ( quit.empty( ) )
+		return 0;
 
-	// account liquidation equity credit of shareholder or bad debt cost of bank
-	liqVal = VS( firm, _NWvar[ sec ] ) - VS( firm, _DebVar[ sec ] );
+	int sec = strcmp( NAMES( quit[ 0 ] ), "Firm1" ) == 0 ? 0 : 1;
 
-	if ( liqVal < 0 )							// account bank losses, if any
+	for ( auto firm : quit )
 	{
-		liqEq = 0;								// no liquidation equity
-		VS( fin, BadDebVar[ sec ] );			// ensure reset in t
-		INCRS( fin, BadDebVar[ sec ], - liqVal );// accumulate bank losses
+		Eq += VS( firm, _EqVar[ sec ] );		// equity to remove
+
+		// liquidation equity credit of shareholder or bad debt cost of bank
+		liqVal = VS( firm, _NWvar[ sec ] ) - VS( firm, _DebVar[ sec ] );
+
+		if ( liqVal < 0 )
+			badDeb -= liqVal;					// bank losses
+		else
+			liqEq += ROUND( liqVal, 0, 0.01 );	// liquidation equity credit
+
+		if ( sec == 1 )
+		{
+			vintTabT *tab = vint_table( firm );
+
+			for ( i = 0; i < ( int ) tab->vint.size( ); ++i )
+			{									// leave vintage registry
+				vint_reg_del( tab->vint[ i ] );	// and machine-age histogram
+				vint_tot_add( firm, i, -1 );
+			}
+		}
 	}
-	else
+
+	// remove equity from sector total and account liquidation
+	INCRS( sector, EqVar[ sec ], - Eq );
+	INCRS( sector, cExitVar[ sec ], liqEq );
+
+	if ( badDeb > 0 )							// account bank losses, if any
 	{
-		liqEq = ROUND( liqVal, 0, 0.01 );		// no liquidation equity credit
-		INCRS( PARENTS( firm ), cExitVar[ sec ], liqEq );
+		VS( fin, BadDebVar[ sec ] );			// ensure reset in t
+		INCRS( fin, BadDebVar[ sec ], badDeb );
 	}
 
-	CYCLES( firm, cli, CliBrochObj[ sec ] )		// leave counterpart lists
-		DELETE( SHOOKS( cli ) );				// delete from counterpart list
+	for ( auto firm : quit )					// leave supplier-client graph
+		edge_del_firm( g, firm, sec == 0 );
 
-	if ( sec == 1 )
-		// update firm map before removing LSD object in consumption sector
-		EXEC_EXTS( GRANDPARENTS( firm ), countryE, firm2map, erase,
-				   ( int ) VS( firm, "_ID2" ) );
+	for ( auto firm : quit )
+	{
+		if ( sec == 1 )
+		{
+			firm_reg_del( reg, VS( firm, "_ID2" ) );// leave firm registry
+			DELETE_EXTS( firm, firm2E );		// reclaim firm extension
+		}
 
-	DELETE( firm );
+		DELETE( firm );
+	}
 
 	return liqEq;
 }
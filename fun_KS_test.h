@@ -1073,7 +1073,8 @@ CYCLES( CAPSECL1, cur, "Firm1" )
 			}
 		}
 
-	j = COUNTS( cur, "Cli" );
+	j = edge_deg( V_EXTS( GRANDPARENTS( cur ), countryE, edges ).degS,
+				  VS( cur, "_ID1" ) );
 
 	double _Atau = VS( cur, "_Atau" );
 	double _Btau = VS( cur, "_Btau" );
@@ -1256,6 +1257,8 @@ double eta = VS( CONSECL1, "eta" );				// machine technical life
 double iota = VS( CONSECL1, "iota" );			// production slack
 double m2 = VS( CONSECL1, "m2" );				// machine scale
 double mu20 = VS( CONSECL1, "mu20" );			// initial mark-up
+double tolA2 = VS( CONSECL1, "tolA2" );			// vintage merging tolerance
+bool vintMerge = VS( PARENT, "flagVintMerge" ) != 0;// vintage merging on?
 
 int errors = 0;									// error counter
 CYCLES( CONSECL1, cur, "Firm2" )
@@ -1294,7 +1297,7 @@ CYCLES( CONSECL1, cur, "Firm2" )
 		v[7] += VS( cur1, "__nVint" );
 		v[8] += VS( cur1, "__Qvint" );
 
-		if ( VS( cur1, "__IDvint" ) < h )
+		if ( T0( VS( cur1, "__IDvint" ) ) < h )
 			IDerr.push_back( cur1 );
 
 		if ( ( h == 1 && VS( cur1, "__tVint" ) < 1 - eta ) ||
@@ -1311,8 +1314,9 @@ CYCLES( CONSECL1, cur, "Firm2" )
 		cur2 = cur1;
 	}
 
-	v[18] = COUNTS( cur, "Broch" );
 	v[19] = COUNTS( cur, "Vint" );
+	v[18] = edge_deg( V_EXTS( GRANDPARENTS( cur ), countryE, edges ).degC,
+					  VS( cur, "_ID2" ) );
 	cur1 = HOOKS( cur, TOPVINT );
 
 	double _A2 = VS( cur, "_A2" );
@@ -1419,6 +1423,11 @@ CYCLES( CONSECL1, cur, "Firm2" )
 	check_error( tVintErr.size( ) > 0,
 				 "INVALID-T-VINT", tVintErr.size( ), & errors );
 
+	// new vintage must be merged into compatible previous ones (count down)
+	check_error( vintMerge && P_EXTS( cur, firm2E )->tInom == T &&
+				 cur1 != NULL && vint_mergeable( SHOOKS( cur1 ), cur1, tolA2 ),
+				 "UNMERGED-VINT", 0, & errors );
+
 	check_error( _SId > _Kavb || _K > _Kavb + _EI + _SI || v[7] * m2 > _K ||
 				 ( _life2cycle > 0 && _K == 0 ),
 				 "INCONSISTENT-CAPITAL", 0, & errors );
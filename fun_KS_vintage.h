@@ -30,23 +30,10 @@ Positive values indicate non-economical machines but still in technical life
 Negative values represent machines out of technical life to be scrapped ASAP
 */
 
-if ( V( "__tVint" ) < T - VS( GRANDPARENT, "eta" ) )// out of technical life?
-	END_EQUATION( - V( "__nVint" ) );			// scrap if not in use
+scrapPlanT *plan = scrap_plan( PARENT );		// firm scrapping plan
 
-VS( PARENT, "_supplier" );						// ensure supplier is selected
-cur = PARENTS( SHOOKS( HOOKS( PARENT, SUPPL ) ) );// pointer to supplier
-v[1] = VS( LABSUPL3, "w" );						// firm wage
-
-// unit cost advantage of new machines
-v[2] = v[1] / V( "__Avint" ) - v[1] / VS( cur, "_Atau" );
-
-// if new machine cost is not better in absolute terms or
-// payback period of replacing current vintage is over b
-if ( v[2] <= 0 ||
-	 VS( cur, "_p1" ) / VS( GRANDPARENT, "m2" ) / v[2] > VS( GRANDPARENT, "b" ) )
-	END_EQUATION( 0 );							// nothing to scrap
-
-RESULT( V( "__nVint" ) )						// scrap if can be replaced
+RESULT( scrap_plan_RS( PARENT, plan, V( "__nVint" ), V( "__Avint" ),
+					   V( "__tVint" ) ) )
 
 
 /*============================ SUPPORT EQUATIONS =============================*/